@@ -0,0 +1,463 @@
+#!/usr/bin/env python3
+"""A local stand-in for the Notion API, serving synthetic databases for tests and benchmarks.
+
+Every database id made of digits only is a database with that many pages, e.g.
+00000000000000000000000000001000 has 1000 pages. Pages and blocks are generated on the fly from their
+index, so databases of millions of pages cost no memory. Page i was created i minutes after the first
+page. Query filters are evaluated like Notion does, comparing date properties by day, so tests can check
+what a pushed down filter selects. A filter made only of created_time conditions, which partitioned scans
+use to slice the database, is answered without generating the pages it skips. Like Notion, the server
+rejects filters with unknown conditions, more than 100 conditions in a compound filter or more than two
+levels of nesting with a 400 validation_error. Sorts are applied like Notion does too, with empty values
+last in either direction.
+
+Point the extension at the server with
+
+    SET notion_api_host = '127.0.0.1';
+    SET notion_api_port = 8787;
+    SET notion_api_use_tls = false;
+
+GET /_stats returns the number of requests served, the bytes sent and the number of injected 429
+responses. POST /_stats/reset clears them.
+
+Usage: notion_mock_server.py [--port 8787] [--latency-ms 0] [--throttle-every 0] [--max-page-size 100]
+                             [--blocks-per-page 5] [--databases 1000,100000,1000000]
+"""
+
+import argparse
+import datetime
+import json
+import math
+import re
+import threading
+import time
+import uuid
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlsplit
+
+EDITED_TIME = "2024-01-01T00:00:00.000Z"
+FIRST_CREATED_TIME = datetime.datetime(2024, 1, 1, tzinfo=datetime.timezone.utc)
+STATUSES = ["Not started", "In progress", "Done"]
+TAGS = ["red", "green", "blue", "yellow"]
+
+PROPERTIES = {
+    "Name": {"id": "title", "type": "title", "title": {}},
+    "Number": {"id": "num", "type": "number", "number": {"format": "number"}},
+    "Status": {"id": "stat", "type": "select", "select": {"options": [{"name": s} for s in STATUSES]}},
+    "Tags": {"id": "tags", "type": "multi_select", "multi_select": {"options": [{"name": t} for t in TAGS]}},
+    "Done": {"id": "done", "type": "checkbox", "checkbox": {}},
+    "Due": {"id": "due", "type": "date", "date": {}},
+    "Notes": {"id": "note", "type": "rich_text", "rich_text": {}},
+}
+
+
+def rich_text(text):
+    return [{"type": "text", "text": {"content": text, "link": None}, "plain_text": text, "href": None}]
+
+
+def dashed(hex_id):
+    return str(uuid.UUID(hex_id))
+
+
+def page_id(database_id, index):
+    # The page index is recoverable from the id, which GET /v1/pages and /v1/blocks rely on
+    return dashed("%016x%016x" % (int(database_id) % (1 << 64), index))
+
+
+def property_value(name, index):
+    if name == "Name":
+        return {"id": "title", "type": "title", "title": rich_text("Page %d" % index)}
+    if name == "Number":
+        return {"id": "num", "type": "number", "number": index * 1.5}
+    if name == "Status":
+        return {"id": "stat", "type": "select", "select": {"name": STATUSES[index % len(STATUSES)]}}
+    if name == "Tags":
+        return {"id": "tags", "type": "multi_select",
+                "multi_select": [{"name": TAGS[index % len(TAGS)]}, {"name": TAGS[(index + 1) % len(TAGS)]}]}
+    if name == "Done":
+        return {"id": "done", "type": "checkbox", "checkbox": index % 2 == 0}
+    if name == "Due":
+        return {"id": "due", "type": "date",
+                "date": {"start": "2024-%02d-%02d" % (index % 12 + 1, index % 28 + 1), "end": None}}
+    return {"id": "note", "type": "rich_text", "rich_text": rich_text("Notes of page %d" % index)}
+
+
+def created_time(index):
+    return (FIRST_CREATED_TIME + datetime.timedelta(minutes=index)).strftime("%Y-%m-%dT%H:%M:%S.000Z")
+
+
+def minutes_since_first(timestamp):
+    return (parse_timestamp(timestamp) - FIRST_CREATED_TIME).total_seconds() / 60
+
+
+def matching_range(query_filter, rows):
+    """Returns the page indexes [low, high) matching the created_time conditions of the filter"""
+    low, high = 0, rows
+    if not query_filter:
+        return low, high
+    for condition in query_filter.get("and", [query_filter]):
+        if condition.get("timestamp") != "created_time":
+            continue
+        for operator, value in condition["created_time"].items():
+            minutes = minutes_since_first(value)
+            if operator == "on_or_after":
+                low = max(low, math.ceil(minutes))
+            elif operator == "after":
+                low = max(low, math.floor(minutes) + 1)
+            elif operator == "before":
+                high = min(high, math.ceil(minutes))
+            elif operator == "on_or_before":
+                high = min(high, math.floor(minutes) + 1)
+    return max(low, 0), max(min(high, rows), low)
+
+
+MAX_FILTER_CONDITIONS = 100
+
+TIMESTAMP_CONDITIONS = {"equals", "before", "after", "on_or_before", "on_or_after", "is_empty", "is_not_empty"}
+FILTER_CONDITIONS = {
+    "title": {"equals", "does_not_equal", "contains", "does_not_contain", "starts_with", "ends_with", "is_empty",
+              "is_not_empty"},
+    "number": {"equals", "does_not_equal", "greater_than", "less_than", "greater_than_or_equal_to",
+               "less_than_or_equal_to", "is_empty", "is_not_empty"},
+    "select": {"equals", "does_not_equal", "is_empty", "is_not_empty"},
+    "multi_select": {"contains", "does_not_contain", "is_empty", "is_not_empty"},
+    "checkbox": {"equals", "does_not_equal"},
+    "date": TIMESTAMP_CONDITIONS,
+}
+FILTER_CONDITIONS["rich_text"] = FILTER_CONDITIONS["title"]
+
+
+class FilterError(Exception):
+    pass
+
+
+def filter_depth(condition):
+    for compound in ("and", "or"):
+        if compound in condition:
+            return 1 + max((filter_depth(child) for child in condition[compound]), default=0)
+    return 0
+
+
+def validate_filter(condition):
+    """Raises FilterError for the filters Notion rejects with a validation_error"""
+    if filter_depth(condition) > 2:
+        raise FilterError("Filters can be nested at most two levels deep.")
+    for compound in ("and", "or"):
+        if compound in condition:
+            if len(condition[compound]) > MAX_FILTER_CONDITIONS:
+                raise FilterError("body.filter.%s should have at most %d items." % (compound, MAX_FILTER_CONDITIONS))
+            for child in condition[compound]:
+                validate_filter(child)
+            return
+    if "timestamp" in condition:
+        type_key, conditions = condition["timestamp"], TIMESTAMP_CONDITIONS
+        if type_key not in ("created_time", "last_edited_time"):
+            raise FilterError("Unknown timestamp %s." % type_key)
+    else:
+        schema = PROPERTIES.get(condition.get("property"))
+        if schema is None:
+            raise FilterError("Could not find property %s." % condition.get("property"))
+        type_key, conditions = schema["type"], FILTER_CONDITIONS[schema["type"]]
+    operators = condition.get(type_key)
+    if not isinstance(operators, dict) or len(operators) != 1 or next(iter(operators)) not in conditions:
+        raise FilterError("Invalid %s filter condition %s." % (type_key, json.dumps(operators)))
+
+
+def parse_timestamp(timestamp):
+    value = datetime.datetime.fromisoformat(timestamp.replace("Z", "+00:00"))
+    if value.tzinfo is None:
+        value = value.replace(tzinfo=datetime.timezone.utc)
+    return value
+
+
+def filter_value(name, index):
+    """The value of a property as Notion filters it, None when empty"""
+    value = property_value(name, index)
+    content = value[value["type"]]
+    if value["type"] in ("title", "rich_text"):
+        return "".join(part["plain_text"] for part in content)
+    if value["type"] == "select":
+        return content["name"] if content else None
+    if value["type"] == "multi_select":
+        return [option["name"] for option in content]
+    if value["type"] == "date":
+        # Dates are compared by day
+        return parse_timestamp(content["start"]).date() if content else None
+    return content
+
+
+def compare(operator, value, operand):
+    if operator == "is_empty":
+        return value is None or value == "" or value == []
+    if operator == "is_not_empty":
+        return not compare("is_empty", value, operand)
+    if value is None:
+        return operator in ("does_not_equal", "does_not_contain")
+    if operator == "equals":
+        return value == operand
+    if operator == "does_not_equal":
+        return value != operand
+    if operator == "contains":
+        return operand in value
+    if operator == "does_not_contain":
+        return operand not in value
+    if operator == "starts_with":
+        return value.startswith(operand)
+    if operator == "ends_with":
+        return value.endswith(operand)
+    if operator in ("greater_than", "after"):
+        return value > operand
+    if operator in ("less_than", "before"):
+        return value < operand
+    if operator in ("greater_than_or_equal_to", "on_or_after"):
+        return value >= operand
+    return value <= operand
+
+
+def page_matches(condition, index):
+    if "and" in condition:
+        return all(page_matches(child, index) for child in condition["and"])
+    if "or" in condition:
+        return any(page_matches(child, index) for child in condition["or"])
+    if "timestamp" in condition:
+        type_key = condition["timestamp"]
+        value = parse_timestamp(created_time(index) if type_key == "created_time" else EDITED_TIME)
+        operator, operand = next(iter(condition[type_key].items()))
+        if operator in ("is_empty", "is_not_empty"):
+            return compare(operator, value, operand)
+        return compare(operator, value, parse_timestamp(operand))
+    schema = PROPERTIES[condition["property"]]
+    value = filter_value(condition["property"], index)
+    operator, operand = next(iter(condition[schema["type"]].items()))
+    if schema["type"] == "date" and operator not in ("is_empty", "is_not_empty"):
+        operand = parse_timestamp(operand).date()
+    return compare(operator, value, operand)
+
+
+def is_created_time_range(query_filter):
+    """Whether the filter only holds created_time conditions, all of which matching_range applies"""
+    if not query_filter:
+        return True
+    return all(condition.get("timestamp") == "created_time" and "created_time" in condition and
+               next(iter(condition["created_time"])) in ("before", "after", "on_or_before", "on_or_after")
+               for condition in query_filter.get("and", [query_filter]))
+
+
+def sort_pages(indexes, sorts):
+    """Orders the page indexes by the sorts, the first sort taking precedence"""
+    indexes = list(indexes)
+    for sort in reversed(sorts):
+        if "timestamp" in sort:
+            key = (lambda i: created_time(i)) if sort["timestamp"] == "created_time" else (lambda i: EDITED_TIME)
+        else:
+            key = (lambda name: lambda i: filter_value(name, i))(sort["property"])
+        # Notion puts empty values last whatever the direction
+        present = [i for i in indexes if key(i) not in (None, "", [])]
+        empty = [i for i in indexes if key(i) in (None, "", [])]
+        present.sort(key=key, reverse=sort.get("direction") == "descending")
+        indexes = present + empty
+    return indexes
+
+
+def make_page(database_id, index, property_ids=None):
+    properties = {}
+    for name, schema in PROPERTIES.items():
+        if property_ids is None or schema["id"] in property_ids:
+            properties[name] = property_value(name, index)
+    return {
+        "object": "page",
+        "id": page_id(database_id, index),
+        "created_time": created_time(index),
+        "last_edited_time": EDITED_TIME,
+        "archived": False,
+        "parent": {"type": "database_id", "database_id": dashed(database_id)},
+        "properties": properties,
+    }
+
+
+def make_database(database_id):
+    return {
+        "object": "database",
+        "id": dashed(database_id),
+        "title": rich_text("Mock %d" % int(database_id)),
+        "created_time": EDITED_TIME,
+        "last_edited_time": EDITED_TIME,
+        "properties": PROPERTIES,
+    }
+
+
+def list_response(results, next_cursor):
+    return {"object": "list", "results": results, "next_cursor": next_cursor, "has_more": next_cursor is not None}
+
+
+class MockState:
+    def __init__(self, args):
+        self.args = args
+        self.lock = threading.Lock()
+        self.requests = 0
+        self.bytes_sent = 0
+        self.throttled = 0
+
+    def stats(self):
+        with self.lock:
+            return {"requests": self.requests, "bytes_sent": self.bytes_sent, "throttled": self.throttled}
+
+    def reset(self):
+        with self.lock:
+            self.requests = 0
+            self.bytes_sent = 0
+            self.throttled = 0
+
+
+class NotionMockHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    server_version = "NotionMock/1.0"
+
+    def log_message(self, format, *args):
+        pass
+
+    @property
+    def state(self):
+        return self.server.state
+
+    def read_body(self):
+        length = int(self.headers.get("Content-Length", 0))
+        if length == 0:
+            return {}
+        return json.loads(self.rfile.read(length))
+
+    def send_json(self, status, body, extra_headers=None):
+        payload = json.dumps(body, separators=(",", ":")).encode()
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(payload)))
+        for name, value in (extra_headers or {}).items():
+            self.send_header(name, value)
+        self.end_headers()
+        self.wfile.write(payload)
+        with self.state.lock:
+            self.state.bytes_sent += len(payload)
+
+    def send_error_object(self, status, code, message):
+        self.send_json(status, {"object": "error", "status": status, "code": code, "message": message})
+
+    def handle_api(self, method):
+        url = urlsplit(self.path)
+        query = parse_qs(url.query)
+        if url.path == "/_stats":
+            if method == "GET":
+                return self.send_json(200, self.state.stats())
+            self.read_body()
+            self.state.reset()
+            return self.send_json(200, self.state.stats())
+
+        # Consume the body first, the connection is kept alive for the next request
+        body = self.read_body() if method in ("POST", "PATCH") else {}
+        args = self.state.args
+        with self.state.lock:
+            self.state.requests += 1
+            throttle = args.throttle_every > 0 and self.state.requests % args.throttle_every == 0
+            if throttle:
+                self.state.throttled += 1
+        if args.latency_ms > 0:
+            time.sleep(args.latency_ms / 1000.0)
+        if throttle:
+            return self.send_json(429, {"object": "error", "status": 429, "code": "rate_limited",
+                                        "message": "Injected rate limit"}, {"Retry-After": "0"})
+
+        page_size = min(int(body.get("page_size", query.get("page_size", ["100"])[0])), args.max_page_size)
+        start = int(body.get("start_cursor", query.get("start_cursor", ["0"])[0]) or 0)
+
+        match = re.fullmatch(r"/v1/databases/([0-9a-f-]+)(/query)?", url.path)
+        if match:
+            database_id = match.group(1).replace("-", "")
+            if not database_id.isdigit():
+                return self.send_error_object(404, "object_not_found", "Could not find database " + database_id)
+            if not match.group(2):
+                return self.send_json(200, make_database(database_id))
+            query_filter = body.get("filter")
+            try:
+                if query_filter:
+                    validate_filter(query_filter)
+            except FilterError as error:
+                return self.send_error_object(400, "validation_error", str(error))
+            low, high = matching_range(query_filter, int(database_id))
+            sorts = body.get("sorts", [])
+            matching = range(low, high)
+            if not is_created_time_range(query_filter):
+                # Every page in the range is generated to evaluate the filter, again for every page of results
+                matching = [i for i in matching if page_matches(query_filter, i)]
+            if sorts and sorts[0].get("timestamp") == "created_time":
+                # Pages are created in index order, so this sort needs no other
+                if sorts[0].get("direction") == "descending":
+                    matching = matching[::-1]
+            elif sorts:
+                matching = sort_pages(matching, sorts)
+            property_ids = set(query["filter_properties"]) if "filter_properties" in query else None
+            end = min(start + page_size, len(matching))
+            results = [make_page(database_id, matching[i], property_ids) for i in range(start, end)]
+            return self.send_json(200, list_response(results, str(end) if end < len(matching) else None))
+
+        if url.path == "/v1/search":
+            databases = [make_database("%032d" % rows) for rows in args.databases]
+            return self.send_json(200, list_response(databases, None))
+
+        if url.path == "/v1/pages" and method == "POST":
+            database_id = body.get("parent", {}).get("database_id", "").replace("-", "")
+            return self.send_json(200, make_page(database_id if database_id.isdigit() else "0" * 32, 0))
+
+        match = re.fullmatch(r"/v1/pages/([0-9a-f-]+)(/properties/[^/]+)?", url.path)
+        if match:
+            if match.group(2):
+                return self.send_json(200, list_response([], None))
+            hex_id = match.group(1).replace("-", "")
+            return self.send_json(200, make_page("%032d" % int(hex_id[:16], 16), int(hex_id[16:], 16)))
+
+        match = re.fullmatch(r"/v1/blocks/([0-9a-f-]+)(/children)?", url.path)
+        if match:
+            block_id = match.group(1).replace("-", "")
+            if not match.group(2):
+                block_type = "child_database" if block_id.isdigit() else "child_page"
+                return self.send_json(200, {"object": "block", "id": dashed(block_id), "type": block_type,
+                                            "has_children": True, block_type: {"title": ""}})
+            end = min(start + page_size, args.blocks_per_page)
+            blocks = [{"object": "block", "id": dashed("%028x%04x" % (int(block_id, 16) % (1 << 112), i)),
+                       "type": "paragraph", "has_children": False,
+                       "paragraph": {"rich_text": rich_text("Paragraph %d" % i)}} for i in range(start, end)]
+            return self.send_json(200, list_response(blocks, str(end) if end < args.blocks_per_page else None))
+
+        return self.send_error_object(404, "invalid_request_url", "Invalid request URL.")
+
+    def do_GET(self):
+        self.handle_api("GET")
+
+    def do_POST(self):
+        self.handle_api("POST")
+
+    def do_PATCH(self):
+        self.handle_api("PATCH")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Local stand-in for the Notion API")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8787)
+    parser.add_argument("--latency-ms", type=float, default=0, help="delay added to every API request")
+    parser.add_argument("--throttle-every", type=int, default=0, help="answer every Nth API request with a 429")
+    parser.add_argument("--max-page-size", type=int, default=100,
+                        help="return at most this many results per page, to exercise pagination")
+    parser.add_argument("--blocks-per-page", type=int, default=5, help="number of child blocks of every page")
+    parser.add_argument("--databases", default="1000,100000,1000000",
+                        help="page counts of the databases returned by /v1/search")
+    args = parser.parse_args()
+    args.databases = [int(rows) for rows in args.databases.split(",") if rows]
+
+    server = ThreadingHTTPServer((args.host, args.port), NotionMockHandler)
+    server.daemon_threads = True
+    server.state = MockState(args)
+    print("Notion mock server listening on %s:%d" % (args.host, server.server_address[1]), flush=True)
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
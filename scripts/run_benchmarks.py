@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""End-to-end scan benchmarks of read_notion against the local mock server (scripts/notion_mock_server.py).
+
+Every benchmark runs in a fresh DuckDB shell and reports:
+- rows/s: rows scanned per second of wall time, shell startup included
+- requests/s: API requests served by the mock server per second
+- MB parsed: bytes of API responses the extension decoded
+- peak MB: the peak resident memory of the shell
+
+Results are printed and written to bench_output.txt.
+
+Usage: run_benchmarks.py [--duckdb build/release/duckdb] [--sizes 1000,100000,1000000] [--latency-ms 0]
+                         [--repetitions 1] [--output bench_output.txt]
+"""
+
+import argparse
+import json
+import os
+import socket
+import subprocess
+import sys
+import time
+import urllib.request
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+
+BENCHMARKS = {
+    # Decodes every property of every page
+    "full_scan": "CREATE TEMP TABLE scanned AS SELECT * FROM read_notion('{id}');",
+    # Only the projected property is requested and decoded
+    "projected_scan": "SELECT sum(Number) FROM read_notion('{id}');",
+    # Requests every page only once the previous one has been decoded, the baseline of the prefetching scans
+    "unprefetched_scan": "SET notion_prefetch_pages = 0; SELECT sum(Number) FROM read_notion('{id}');",
+    # Slices the database on created_time and scans the slices concurrently
+    "partitioned_scan": "CREATE TEMP TABLE scanned AS SELECT * FROM read_notion('{id}', partitions := 4);",
+}
+
+
+def free_port():
+    with socket.socket() as sock:
+        sock.bind(("127.0.0.1", 0))
+        return sock.getsockname()[1]
+
+
+def mock_request(port, method, path):
+    request = urllib.request.Request("http://127.0.0.1:%d%s" % (port, path), method=method, data=b"" if method == "POST" else None)
+    with urllib.request.urlopen(request) as response:
+        return json.load(response)
+
+
+def run_shell(duckdb, extension, port, sql):
+    setup = []
+    if extension:
+        setup.append("LOAD '%s';" % extension)
+    setup += [
+        "SET notion_api_host = '127.0.0.1';",
+        "SET notion_api_port = %d;" % port,
+        "SET notion_api_use_tls = false;",
+        # The mock server has no rate limit of its own
+        "SET notion_requests_per_second = 1000000;",
+        "SET notion_request_burst = 1000000;",
+        "CREATE SECRET mock (TYPE notion, PROVIDER access_token, TOKEN 'mock');",
+    ]
+    start = time.monotonic()
+    process = subprocess.Popen([duckdb, "-unsigned", "-c", "\n".join(setup + [sql])],
+                               stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    _, status, usage = os.wait4(process.pid, 0)
+    elapsed = time.monotonic() - start
+    stderr = process.stderr.read().decode()
+    process.stderr.close()
+    if os.waitstatus_to_exitcode(status) != 0 or "Error" in stderr:
+        raise RuntimeError("Benchmark query failed: %s\n%s" % (sql, stderr))
+    # ru_maxrss is in kilobytes on Linux and in bytes on macOS
+    peak_bytes = usage.ru_maxrss if sys.platform == "darwin" else usage.ru_maxrss * 1024
+    return elapsed, peak_bytes
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Scan benchmarks of read_notion against the mock Notion API")
+    parser.add_argument("--duckdb", default="build/release/duckdb", help="DuckDB shell to run the benchmarks with")
+    parser.add_argument("--extension", default="", help="extension file to LOAD, when not linked into the shell")
+    parser.add_argument("--sizes", default="1000,100000,1000000", help="page counts of the scanned databases")
+    parser.add_argument("--benchmarks", default=",".join(BENCHMARKS), help="benchmarks to run")
+    parser.add_argument("--latency-ms", type=float, default=0, help="latency the mock server adds to every request")
+    parser.add_argument("--repetitions", type=int, default=1)
+    parser.add_argument("--output", default="bench_output.txt")
+    args = parser.parse_args()
+
+    sizes = [int(size) for size in args.sizes.split(",") if size]
+    port = free_port()
+    server = subprocess.Popen([sys.executable, os.path.join(SCRIPT_DIR, "notion_mock_server.py"), "--port", str(port),
+                               "--latency-ms", str(args.latency_ms), "--databases", args.sizes],
+                              stdout=subprocess.PIPE)
+    server.stdout.readline()
+
+    lines = ["%-18s %10s %12s %12s %10s %10s %10s" %
+             ("benchmark", "rows", "seconds", "rows/s", "req/s", "MB parsed", "peak MB")]
+    print(lines[0], flush=True)
+    try:
+        for size in sizes:
+            for name in args.benchmarks.split(","):
+                sql = BENCHMARKS[name].format(id="%032d" % size)
+                for _ in range(args.repetitions):
+                    mock_request(port, "POST", "/_stats/reset")
+                    elapsed, peak_bytes = run_shell(args.duckdb, args.extension, port, sql)
+                    stats = mock_request(port, "GET", "/_stats")
+                    line = "%-18s %10d %12.3f %12.0f %10.1f %10.1f %10.1f" % (
+                        name, size, elapsed, size / elapsed, stats["requests"] / elapsed,
+                        stats["bytes_sent"] / 1e6, peak_bytes / 1e6)
+                    lines.append(line)
+                    print(line, flush=True)
+    finally:
+        server.terminate()
+        server.wait()
+
+    with open(args.output, "w") as output:
+        output.write("\n".join(lines) + "\n")
+
+
+if __name__ == "__main__":
+    main()
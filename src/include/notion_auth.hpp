@@ -2,12 +2,16 @@
 
 #include <string>
 #include "duckdb/main/database.hpp"
+#include "duckdb/main/client_context.hpp"
 
 namespace duckdb
 {
 
     std::string read_token_from_file(const std::string &file_path);
 
+    //! Returns the token of the 'notion' secret that applies to the context, or of the secret with the given name
+    std::string get_notion_token(ClientContext &context, const std::string &secret_name = "");
+
     std::string InitiateOAuthFlow();
 
     struct CreateNotionSecretFunctions
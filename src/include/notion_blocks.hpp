@@ -0,0 +1,83 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/function/table_function.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace duckdb
+{
+    struct NotionApiContext;
+
+    //! The maximum number of threads walking block trees at once. Most time is spent waiting on requests,
+    //! so this is about keeping enough requests in flight to use the rate limit.
+    static constexpr idx_t NOTION_BLOCKS_MAX_THREADS = 8;
+
+    struct NotionBlocksFunctionData : public TableFunctionData
+    {
+        //! The page, or the database whose pages are read
+        string id;
+        //! The token of the secret the blocks are read with, looked up once at bind time
+        string token;
+        //! The deepest level of blocks returned, top-level blocks of a page are at depth 0
+        idx_t max_depth = DConstants::INVALID_INDEX;
+    };
+
+    //! Fetching one page of the children of a block
+    struct NotionBlockTask
+    {
+        //! The page the block belongs to
+        string page_id;
+        string block_id;
+        //! The depth of the children
+        idx_t depth;
+        //! The number of children fetched before this page of children, and where to continue
+        idx_t offset = 0;
+        string cursor;
+    };
+
+    //! The tasks of one thread. A thread works through its own tasks newest first, which walks the tree depth
+    //! first, and takes the oldest task of another thread once it has none left.
+    struct NotionBlockQueue
+    {
+        std::mutex lock;
+        std::deque<NotionBlockTask> tasks;
+    };
+
+    struct NotionBlocksGlobalState : public GlobalTableFunctionState
+    {
+        //! The token, settings and pools shared by every thread of the scan
+        shared_ptr<NotionApiContext> api;
+        vector<column_t> column_ids;
+        vector<unique_ptr<NotionBlockQueue>> queues;
+        //! The next queue to hand to a thread
+        std::atomic<idx_t> next_queue{0};
+        //! The number of tasks queued or being fetched. The scan is done once it is 0.
+        std::atomic<idx_t> pending{0};
+        //! The number of tasks queued and not yet taken by a thread
+        std::atomic<idx_t> queued{0};
+        std::mutex wait_lock;
+        //! Signalled, under wait_lock, when tasks are queued or the last task has finished
+        std::condition_variable work_available;
+
+        idx_t MaxThreads() const override
+        {
+            return NOTION_BLOCKS_MAX_THREADS;
+        }
+    };
+
+    struct NotionBlocksLocalState : public LocalTableFunctionState
+    {
+        idx_t queue_index;
+    };
+
+    /**
+     * read_notion_blocks('page or database') returns one row per block of a page, or of every page of a database,
+     * with nested blocks following their parent at the next depth. Every level of the tree is another request,
+     * so the children of blocks are fetched by several threads that share a work-stealing queue.
+     */
+    TableFunction notion_read_blocks_table_function();
+
+} // namespace duckdb
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/storage/object_cache.hpp"
+#include <mutex>
+#include <string>
+
+namespace duckdb
+{
+
+    //! The capacity of a buffer for a response of unknown length, e.g. a chunked one
+    static constexpr idx_t NOTION_DEFAULT_RESPONSE_CAPACITY = 64 * 1024;
+    //! Buffers are pooled in power of two size classes from 16 KB up to 8 MB. Larger buffers are freed.
+    static constexpr idx_t NOTION_BUFFER_POOL_MIN_CLASS = 14;
+    static constexpr idx_t NOTION_BUFFER_POOL_MAX_CLASS = 23;
+    //! The total capacity of the idle buffers kept per database instance
+    static constexpr idx_t NOTION_BUFFER_POOL_MAX_BYTES = 32 * 1024 * 1024;
+
+    //! Recycles the buffers API responses are read into. A page of query results is a few hundred kilobytes,
+    //! so allocating a fresh body for every page means large allocations, which the allocator hands back to
+    //! the system on free, and page faults on every first write. Buffers keep their capacity in the pool and
+    //! are handed out again by size class. There is one pool per database instance, stored in its ObjectCache.
+    class NotionBufferPool : public ObjectCacheEntry
+    {
+    public:
+        //! Returns the pool of the database instance, creating it on first use
+        static shared_ptr<NotionBufferPool> Get(ClientContext &context);
+
+        static string ObjectType()
+        {
+            return "notion_buffer_pool";
+        }
+
+        string GetObjectType() override
+        {
+            return ObjectType();
+        }
+
+        //! Returns an empty buffer with at least the given capacity
+        std::string Acquire(idx_t capacity);
+
+        //! Takes back a buffer that is no longer used, freeing it if the pool is full
+        void Release(std::string buffer);
+
+    private:
+        std::mutex lock;
+        //! The idle buffers of every size class. A buffer of class i has a capacity of at least 2^i bytes.
+        vector<std::string> buffers[NOTION_BUFFER_POOL_MAX_CLASS + 1];
+        idx_t pooled_bytes = 0;
+    };
+
+} // namespace duckdb
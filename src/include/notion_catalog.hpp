@@ -0,0 +1,175 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/catalog/catalog.hpp"
+#include "duckdb/catalog/catalog_entry/schema_catalog_entry.hpp"
+#include "duckdb/catalog/catalog_entry/table_catalog_entry.hpp"
+#include "duckdb/storage/storage_extension.hpp"
+#include "duckdb/transaction/transaction.hpp"
+#include "duckdb/transaction/transaction_manager.hpp"
+#include "notion_read.hpp"
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace duckdb
+{
+
+    //! A database of the workspace. Its columns are those read_notion binds for the database, and
+    //! scanning it runs read_notion.
+    class NotionTableEntry : public TableCatalogEntry
+    {
+    public:
+        NotionTableEntry(Catalog &catalog, SchemaCatalogEntry &schema, CreateTableInfo &info,
+                         unique_ptr<NotionReadFunctionData> bind_data, std::string last_edited_time);
+
+        unique_ptr<BaseStatistics> GetStatistics(ClientContext &context, column_t column_id) override;
+        TableFunction GetScanFunction(ClientContext &context, unique_ptr<FunctionData> &bind_data) override;
+        TableStorageInfo GetStorageInfo(ClientContext &context) override;
+
+    public:
+        //! The id of the database, 32 hex characters
+        std::string database_id;
+        //! The read_notion bind of the database the columns were taken from, copied for every scan
+        unique_ptr<NotionReadFunctionData> bind_data;
+        //! The last_edited_time of the database when it was bound, which changes along with its schema
+        std::string last_edited_time;
+    };
+
+    //! The single "main" schema of an attached workspace, holding a table for every database shared with
+    //! the integration. Tables are created when they are first looked up, so attaching a workspace doesn't
+    //! fetch anything, and querying one database only binds that database.
+    class NotionSchemaEntry : public SchemaCatalogEntry
+    {
+    public:
+        NotionSchemaEntry(Catalog &catalog, CreateSchemaInfo &info);
+
+        void Scan(ClientContext &context, CatalogType type, const std::function<void(CatalogEntry &)> &callback) override;
+        void Scan(CatalogType type, const std::function<void(CatalogEntry &)> &callback) override;
+        optional_ptr<CatalogEntry> GetEntry(CatalogTransaction transaction, CatalogType type, const string &name) override;
+
+        optional_ptr<CatalogEntry> CreateIndex(CatalogTransaction transaction, CreateIndexInfo &info,
+                                               TableCatalogEntry &table) override;
+        optional_ptr<CatalogEntry> CreateFunction(CatalogTransaction transaction, CreateFunctionInfo &info) override;
+        optional_ptr<CatalogEntry> CreateTable(CatalogTransaction transaction, BoundCreateTableInfo &info) override;
+        optional_ptr<CatalogEntry> CreateView(CatalogTransaction transaction, CreateViewInfo &info) override;
+        optional_ptr<CatalogEntry> CreateSequence(CatalogTransaction transaction, CreateSequenceInfo &info) override;
+        optional_ptr<CatalogEntry> CreateTableFunction(CatalogTransaction transaction, CreateTableFunctionInfo &info) override;
+        optional_ptr<CatalogEntry> CreateCopyFunction(CatalogTransaction transaction, CreateCopyFunctionInfo &info) override;
+        optional_ptr<CatalogEntry> CreatePragmaFunction(CatalogTransaction transaction, CreatePragmaFunctionInfo &info) override;
+        optional_ptr<CatalogEntry> CreateCollation(CatalogTransaction transaction, CreateCollationInfo &info) override;
+        optional_ptr<CatalogEntry> CreateType(CatalogTransaction transaction, CreateTypeInfo &info) override;
+        void DropEntry(ClientContext &context, DropInfo &info) override;
+        void Alter(CatalogTransaction transaction, AlterInfo &info) override;
+
+    private:
+        //! Lists the databases of the workspace unless the last listing is recent enough. Every listed
+        //! database object seeds the schema cache, so binding its table doesn't fetch it again.
+        void RefreshTableNames(ClientContext &context);
+
+        //! Returns the table of the database as of its current schema
+        NotionTableEntry &GetTable(ClientContext &context, const std::string &name, const std::string &database_id);
+
+    private:
+        std::mutex lock;
+        //! The database id of every table, by table name
+        case_insensitive_map_t<std::string> database_ids;
+        std::chrono::steady_clock::time_point listed_at;
+        bool listed = false;
+        //! The table entry of the current schema of every database looked up, by table name
+        case_insensitive_map_t<unique_ptr<NotionTableEntry>> tables;
+        //! The entry a table had before its schema last changed. Queries bound just before the change may still
+        //! refer to it, so it is kept until the next change rather than destroyed right away.
+        case_insensitive_map_t<unique_ptr<NotionTableEntry>> replaced_tables;
+    };
+
+    //! A Notion workspace attached with ATTACH '' AS workspace (TYPE notion). It is read only: every database
+    //! shared with the integration is a table of its "main" schema. Like read_notion, it reads with the token
+    //! of the 'notion' secret that applies when a statement runs, or of the secret named by the SECRET option.
+    class NotionCatalog : public Catalog
+    {
+    public:
+        NotionCatalog(AttachedDatabase &db, std::string secret_name);
+
+        //! Returns the token to read the workspace with
+        std::string GetToken(ClientContext &context);
+        //! The read_notion options the tables are scanned with
+        named_parameter_map_t ScanOptions() const;
+
+        void Initialize(bool load_builtin) override;
+        string GetCatalogType() override
+        {
+            return "notion";
+        }
+
+        optional_ptr<CatalogEntry> CreateSchema(CatalogTransaction transaction, CreateSchemaInfo &info) override;
+        void ScanSchemas(ClientContext &context, std::function<void(SchemaCatalogEntry &)> callback) override;
+        optional_ptr<SchemaCatalogEntry> GetSchema(CatalogTransaction transaction, const string &schema_name,
+                                                   OnEntryNotFound if_not_found,
+                                                   QueryErrorContext error_context = QueryErrorContext()) override;
+
+        unique_ptr<PhysicalOperator> PlanCreateTableAs(ClientContext &context, LogicalCreateTable &op,
+                                                       unique_ptr<PhysicalOperator> plan) override;
+        unique_ptr<PhysicalOperator> PlanInsert(ClientContext &context, LogicalInsert &op,
+                                                unique_ptr<PhysicalOperator> plan) override;
+        unique_ptr<PhysicalOperator> PlanDelete(ClientContext &context, LogicalDelete &op,
+                                                unique_ptr<PhysicalOperator> plan) override;
+        unique_ptr<PhysicalOperator> PlanUpdate(ClientContext &context, LogicalUpdate &op,
+                                                unique_ptr<PhysicalOperator> plan) override;
+        unique_ptr<LogicalOperator> BindCreateIndex(Binder &binder, CreateStatement &stmt, TableCatalogEntry &table,
+                                                    unique_ptr<LogicalOperator> plan) override;
+
+        DatabaseSize GetDatabaseSize(ClientContext &context) override;
+        bool InMemory() override
+        {
+            return false;
+        }
+        string GetDBPath() override
+        {
+            return string();
+        }
+        void DropSchema(ClientContext &context, DropInfo &info) override;
+
+    private:
+        unique_ptr<NotionSchemaEntry> main_schema;
+        //! The name of the secret set with ATTACH ... (TYPE notion, SECRET name), empty for the default one
+        std::string secret_name;
+    };
+
+    //! Nothing is written to an attached workspace, so its transactions hold no state
+    class NotionTransaction : public Transaction
+    {
+    public:
+        NotionTransaction(TransactionManager &manager, ClientContext &context) : Transaction(manager, context)
+        {
+        }
+    };
+
+    class NotionTransactionManager : public TransactionManager
+    {
+    public:
+        explicit NotionTransactionManager(AttachedDatabase &db) : TransactionManager(db)
+        {
+        }
+
+        Transaction &StartTransaction(ClientContext &context) override;
+        ErrorData CommitTransaction(ClientContext &context, Transaction &transaction) override;
+        void RollbackTransaction(Transaction &transaction) override;
+        void Checkpoint(ClientContext &context, bool force = false) override
+        {
+        }
+
+    private:
+        std::mutex lock;
+        std::unordered_map<Transaction *, unique_ptr<NotionTransaction>> transactions;
+    };
+
+    //! Registers the notion type for ATTACH
+    class NotionStorageExtension : public StorageExtension
+    {
+    public:
+        NotionStorageExtension();
+    };
+
+} // namespace duckdb
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/common/types/vector.hpp"
+#include "notion_utils.hpp"
+
+namespace duckdb
+{
+
+    /**
+     * Returns the type of the column a property is read into. Properties holding several values are read
+     * into LISTs and objects such as users or files into STRUCTs.
+     * @param property The property object of the database schema, which holds e.g. the function of a rollup
+     * @return The column type
+     */
+    LogicalType notion_type_to_duckdb_type(const json &property);
+
+    /**
+     * Returns the type date properties are read into with date_ranges := true, STRUCT(start, end, time_zone)
+     * @return The column type
+     */
+    LogicalType notion_date_range_type();
+
+    /**
+     * Writes the value of a page property straight into a flat output vector.
+     * @param prop_value The property value object of the page, e.g. {"id": "...", "type": "number", "number": 3}
+     * @param result The output vector of the column, of the type returned by notion_type_to_duckdb_type
+     * @param row_index The row to write
+     */
+    typedef void (*notion_column_writer_t)(const json &prop_value, Vector &result, idx_t row_index);
+
+    /**
+     * Returns the column writer for a property type. Writers are resolved once at bind time so the scan
+     * does no per-cell type dispatch.
+     * @param type The Notion property type
+     * @return The writer for columns of that type
+     */
+    notion_column_writer_t get_notion_column_writer(NotionPropertyType type);
+
+    /**
+     * Returns the writer of the page id column. Like the created_time and last_edited_time writers it is
+     * passed the page object itself, which holds these fields at the top level.
+     * @return The writer for the page id
+     */
+    notion_column_writer_t get_notion_page_id_writer();
+
+    /**
+     * Returns the writer of a date property read as a whole range, into a column of notion_date_range_type()
+     * @return The writer for date ranges
+     */
+    notion_column_writer_t get_notion_date_range_writer();
+
+} // namespace duckdb
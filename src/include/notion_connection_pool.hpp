@@ -0,0 +1,108 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/storage/object_cache.hpp"
+#include "notion_buffer_pool.hpp"
+#include <openssl/ssl.h>
+#include <openssl/bio.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace duckdb
+{
+
+    //! The maximum number of idle connections kept open per database instance
+    static constexpr idx_t NOTION_POOL_MAX_IDLE_CONNECTIONS = 8;
+    //! Idle connections older than this are closed instead of being reused. Notion's load balancers
+    //! drop idle keep-alive connections after about a minute, so stay well below that.
+    static constexpr int64_t NOTION_POOL_IDLE_TIMEOUT_SECONDS = 30;
+    //! How long reading or writing a socket may block before the request fails, so a stalled connection
+    //! can't hold up a query, or a thread that is being stopped, indefinitely
+    static constexpr int64_t NOTION_POOL_SOCKET_TIMEOUT_SECONDS = 60;
+
+    struct NotionHttpResponse
+    {
+        int status = 0;
+        //! Response headers, keyed by lower case header name
+        std::unordered_map<std::string, std::string> headers;
+        std::string body;
+        //! Whether the connection can carry another request after this response
+        bool keep_alive = true;
+        //! Whether the request opened a new connection, and how long its handshake took
+        bool new_connection = false;
+        uint64_t handshake_us = 0;
+        //! Time from sending the request until the first byte of the response arrived
+        uint64_t time_to_first_byte_us = 0;
+    };
+
+    //! A single connection to the Notion API that can carry several requests
+    struct NotionHttpConnection
+    {
+        explicit NotionHttpConnection(BIO *bio) : bio(bio) {}
+        ~NotionHttpConnection();
+
+        BIO *bio;
+        std::chrono::steady_clock::time_point last_used;
+        //! How long connecting, including the TLS handshake, took
+        uint64_t handshake_us = 0;
+        //! The number of requests completed on this connection
+        idx_t requests = 0;
+    };
+
+    //! Keeps connections to the Notion API open between requests. There is one pool per database
+    //! instance and endpoint, stored in its ObjectCache, sharing one SSL_CTX and the last TLS session so
+    //! new connections can resume instead of doing a full handshake. Connections are plain TCP when TLS
+    //! is disabled, e.g. for a local mock server.
+    class NotionConnectionPool : public ObjectCacheEntry
+    {
+    public:
+        NotionConnectionPool(std::string host, int port, bool use_tls, bool verify_tls);
+        ~NotionConnectionPool() override;
+
+        //! Returns the pool of the database instance for the given endpoint, creating it on first use
+        static shared_ptr<NotionConnectionPool> Get(ClientContext &context, const std::string &host, int port,
+                                                    bool use_tls, bool verify_tls);
+
+        static string ObjectType()
+        {
+            return "notion_connection_pool";
+        }
+
+        string GetObjectType() override
+        {
+            return ObjectType();
+        }
+
+        //! Sends a raw HTTP/1.1 request and reads the full response. An idle connection is reused if
+        //! one is available; if it turns out to have been closed by the server before anything came back,
+        //! the request is sent once more on a fresh connection, provided it wasn't fully written or is
+        //! idempotent. The body is read into a buffer of the given pool.
+        NotionHttpResponse Perform(const std::string &request, bool idempotent, NotionBufferPool &buffers);
+
+    private:
+        unique_ptr<NotionHttpConnection> Acquire();
+        void Release(unique_ptr<NotionHttpConnection> connection);
+        //! Opens a new connection and times its handshake
+        unique_ptr<NotionHttpConnection> Connect();
+        unique_ptr<NotionHttpConnection> Open();
+
+        static int StoreSession(SSL *ssl, SSL_SESSION *session);
+
+    private:
+        std::string host;
+        int port;
+        bool use_tls;
+        //! Whether the server certificate is checked against the system CA store and the host name
+        bool verify_tls;
+        std::mutex lock;
+        //! Null when TLS is disabled
+        SSL_CTX *ctx = nullptr;
+        //! The most recent session handed out by the server, used to resume new connections
+        SSL_SESSION *session = nullptr;
+        //! Idle connections, the most recently used at the back
+        vector<unique_ptr<NotionHttpConnection>> idle_connections;
+    };
+
+} // namespace duckdb
@@ -1,41 +1,64 @@
-// Taken with minor modifications from https://github.com/duckdb/postgres_scanner/blob/main/src/include/postgres_binary_copy.hpp
-
 #pragma once
 
 #include "duckdb/function/copy_function.hpp"
+#include "notion_property_encoder.hpp"
+#include "notion_request_dispatcher.hpp"
+#include "notion_column_writer.hpp"
+#include <atomic>
+#include <unordered_map>
 
 namespace duckdb
 {
+    //! The number of failed rows listed in the error of a COPY
+    static constexpr idx_t NOTION_COPY_MAX_REPORTED_ERRORS = 10;
+
+    //! A page of the database found by its upsert key
+    struct NotionUpsertTarget
+    {
+        //! Empty for a key whose page is created by this COPY
+        std::string page_id;
+        //! The hash of the written properties as they are stored in Notion
+        hash_t properties_hash;
+        //! Whether a row of this COPY has the key. Requests are sent concurrently, so a second row with the
+        //! key could be applied before the first.
+        bool copied = false;
+    };
+
     struct NotionCopyGlobalState : public GlobalFunctionData
     {
-        explicit NotionCopyGlobalState(ClientContext &context, const string &spreadsheet_id, const string &token, const string &sheet_name)
-            : spreadsheet_id(spreadsheet_id), token(token), sheet_name(sheet_name)
+        explicit NotionCopyGlobalState(ClientContext &context, const string &token, idx_t concurrency)
+            : api(make_shared_ptr<NotionApiContext>(context, token)), dispatcher(context, api, concurrency)
         {
         }
 
     public:
-        string spreadsheet_id;
-        string token;
-        string sheet_name;
-    };
-
-    struct NotionWriteOptions
-    {
-        vector<string> name_list;
+        //! The token, settings and pools of the COPY, shared by the upsert index scan and the dispatcher
+        shared_ptr<NotionApiContext> api;
+        NotionRequestDispatcher dispatcher;
+        //! The number of rows sunk so far, used to number rows in error messages
+        std::atomic<idx_t> rows {0};
+        //! The pages of the database by upsert key, loaded before the first row is written. Keys of created pages
+        //! are added as their rows are sent.
+        std::unordered_map<std::string, NotionUpsertTarget> upsert_index;
     };
 
     struct NotionWriteBindData : public TableFunctionData
     {
-        vector<string> files;
-        NotionWriteOptions options;
-        vector<LogicalType> sql_types;
-
-        NotionWriteBindData(string file_path, vector<LogicalType> sql_types, vector<string> names)
-            : sql_types(std::move(sql_types))
-        {
-            files.push_back(std::move(file_path));
-            options.name_list = std::move(names);
-        }
+        string database_id;
+        string token;
+        //! The name of the property every column is written to
+        vector<string> property_names;
+        //! The encoder of every column, resolved from the type of its property
+        vector<notion_property_encoder_t> encoders;
+        idx_t concurrency = NOTION_DEFAULT_WRITE_CONCURRENCY;
+        //! Whether rows that Notion rejects are skipped instead of failing the COPY
+        bool ignore_errors = false;
+        //! The column matched against existing pages with upsert_key, INVALID_INDEX to only create pages
+        idx_t upsert_column = DConstants::INVALID_INDEX;
+        //! The property id, read type and column writer of every column, used to read existing pages for upserts
+        vector<string> property_ids;
+        vector<LogicalType> read_types;
+        vector<notion_column_writer_t> column_writers;
     };
 
     class NotionCopyFunction : public CopyFunction
@@ -50,6 +73,8 @@ namespace duckdb
         static unique_ptr<LocalFunctionData> NotionWriteInitializeLocal(ExecutionContext &context, FunctionData &bind_data_p);
 
         static void NotionWriteSink(ExecutionContext &context, FunctionData &bind_data_p, GlobalFunctionData &gstate, LocalFunctionData &lstate, DataChunk &input);
+
+        static void NotionWriteFinalize(ClientContext &context, FunctionData &bind_data_p, GlobalFunctionData &gstate);
     };
 
-} // namespace duckdb
\ No newline at end of file
+} // namespace duckdb
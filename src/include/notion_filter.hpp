@@ -0,0 +1,33 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/planner/table_filter.hpp"
+#include "notion_utils.hpp"
+
+namespace duckdb
+{
+
+    //! Notion rejects compound filters with more conditions than this
+    static constexpr idx_t NOTION_MAX_FILTER_CONDITIONS = 100;
+
+    /**
+     * Translates the table filters of a scan into a Notion query filter.
+     * Conditions that can't be expressed in Notion's filter language are left out, so the result
+     * always matches a superset of the rows the table filters accept.
+     * @param filters The table filters, keyed by index into column_ids
+     * @param column_ids The property index of every scanned column
+     * @param properties The properties of the database
+     * @return The value for the "filter" field of a query request, or null if nothing could be translated
+     */
+    json notion_filter_from_table_filters(const TableFilterSet &filters, const vector<column_t> &column_ids,
+                                          const vector<NotionProperty> &properties);
+
+    /**
+     * Builds the condition for pages edited at or after a point in time. Notion rounds last_edited_time down to
+     * the minute, so an "after" condition could miss pages edited later in the same minute.
+     * @param since The point in time, in UTC
+     * @return The condition on the last_edited_time timestamp
+     */
+    json notion_last_edited_since_filter(timestamp_t since);
+
+} // namespace duckdb
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/storage/object_cache.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace duckdb
+{
+
+    //! Counters of the Notion API traffic, either of a whole database instance or of a single scan
+    struct NotionMetrics
+    {
+        std::atomic<uint64_t> requests{0};
+        //! Requests sent again after a 429 or 5xx response
+        std::atomic<uint64_t> retries{0};
+        std::atomic<uint64_t> throttled_responses{0};
+        //! Bytes of response bodies received
+        std::atomic<uint64_t> bytes_received{0};
+        //! New connections, each with a TCP and TLS handshake
+        std::atomic<uint64_t> connections_opened{0};
+        std::atomic<uint64_t> handshake_us{0};
+        //! Time from sending a request until the first byte of its response arrived
+        std::atomic<uint64_t> time_to_first_byte_us{0};
+        //! Time requests were held back by the rate limiter
+        std::atomic<uint64_t> rate_limit_wait_us{0};
+        //! Time spent decoding responses into vectors
+        std::atomic<uint64_t> parse_us{0};
+        std::atomic<uint64_t> rows{0};
+
+        //! Returns every counter by name, in a fixed order
+        vector<std::pair<std::string, uint64_t>> Snapshot() const;
+    };
+
+    //! A counter of NotionMetrics, e.g. &NotionMetrics::requests
+    typedef std::atomic<uint64_t> NotionMetrics::*notion_metric_t;
+
+    //! The cumulative counters of the database instance, and those of the scan that finished last
+    class NotionInstanceMetrics : public ObjectCacheEntry
+    {
+    public:
+        //! Returns the counters of the database instance, creating them on first use
+        static shared_ptr<NotionInstanceMetrics> Get(ClientContext &context);
+
+        static string ObjectType()
+        {
+            return "notion_metrics";
+        }
+
+        string GetObjectType() override
+        {
+            return ObjectType();
+        }
+
+        //! Keeps a copy of the counters of a finished scan
+        void StoreLastScan(const NotionMetrics &scan);
+
+        //! Returns the counters of the scan that finished last, all zero if there was none
+        vector<std::pair<std::string, uint64_t>> LastScan();
+
+    public:
+        NotionMetrics metrics;
+
+    private:
+        std::mutex lock;
+        vector<std::pair<std::string, uint64_t>> last_scan;
+    };
+
+    //! While alive, the metrics recorded on this thread are also added to the counters of a scan
+    class NotionMetricsScope
+    {
+    public:
+        explicit NotionMetricsScope(NotionMetrics &scan);
+        ~NotionMetricsScope();
+
+    private:
+        NotionMetrics *previous;
+    };
+
+    //! Adds to a counter of the database instance and of the scan running on this thread, if any. The instance
+    //! counters are resolved once by the caller, e.g. in its NotionApiContext, rather than looked up every time.
+    void notion_record_metric(NotionInstanceMetrics &instance, notion_metric_t counter, uint64_t value);
+
+    //! Returns the microseconds elapsed since the given point in time
+    uint64_t notion_elapsed_us(std::chrono::steady_clock::time_point start);
+
+    /**
+     * notion_metrics() returns the cumulative counters of the Notion API traffic of the database instance, one
+     * row per counter, e.g. for a Prometheus exporter. With last_scan := true it returns the counters of the
+     * read_notion scan that finished last instead, e.g. after EXPLAIN ANALYZE of a slow query.
+     */
+    TableFunction notion_metrics_table_function();
+
+} // namespace duckdb
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/optimizer/optimizer_extension.hpp"
+
+namespace duckdb
+{
+
+    /**
+     * Optimizer extension that pushes ORDER BY ... LIMIT (Top-N) and plain LIMIT over read_notion into
+     * the Notion query as sorts, a page size and a row limit, so the scan stops paginating as soon
+     * as it has produced enough rows. The Top-N and LIMIT operators themselves stay in the plan.
+     */
+    void notion_optimize_function(OptimizerExtensionInput &input, unique_ptr<LogicalOperator> &plan);
+
+} // namespace duckdb
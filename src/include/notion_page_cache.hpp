@@ -0,0 +1,54 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/common/types/data_chunk.hpp"
+#include "duckdb/main/connection.hpp"
+#include <string>
+
+namespace duckdb
+{
+
+    struct NotionReadFunctionData;
+    struct NotionReadGlobalState;
+
+    //! How long a cache entry is only refreshed with changed pages before it is fetched in full again.
+    //! Archived and trashed pages are not returned by Notion, so only a full fetch removes them.
+    static constexpr int64_t NOTION_DEFAULT_PAGE_CACHE_MAX_AGE_SECONDS = 3600;
+
+    //! Serves read_notion scans from a DuckDB database file in the notion_page_cache_directory, opened in a
+    //! database instance of its own. Each entry holds the pages of a database as seen by one token for one set
+    //! of projected properties, along with the page id and last_edited_time. A scan first fetches the pages
+    //! edited since the newest cached last_edited_time and merges them by page id, then reads every row from
+    //! the file. Filters are not part of the key as read_notion evaluates them exactly on the scanned rows anyway.
+    class NotionPageCache
+    {
+    public:
+        //! Brings the cache entry of the scan up to date and starts reading it. Returns null if no
+        //! notion_page_cache_directory is set or the cache can't be used, e.g. because another process
+        //! holds the cache file, so the scan reads from Notion.
+        static unique_ptr<NotionPageCache> Open(ClientContext &context, const NotionReadFunctionData &bind_data,
+                                                const NotionReadGlobalState &gstate);
+
+        //! Makes the next scan of every entry fetch its pages in full
+        static void Clear(ClientContext &context);
+
+        //! Reads the next chunk of cached rows into the output, returns false once every row has been read
+        bool Scan(DataChunk &output);
+
+    private:
+        explicit NotionPageCache(shared_ptr<DuckDB> db);
+
+        void Refresh(ClientContext &context, const NotionReadFunctionData &bind_data, const NotionReadGlobalState &gstate,
+                     const std::string &table, const std::string &signature, int64_t max_age_seconds);
+
+    private:
+        //! The database instance of the cache file, kept open for as long as the connection is in use
+        shared_ptr<DuckDB> db;
+        //! The connection the cache file is read and written through
+        unique_ptr<Connection> con;
+        unique_ptr<QueryResult> result;
+        //! The chunk currently referenced by the output
+        unique_ptr<DataChunk> chunk;
+    };
+
+} // namespace duckdb
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/common/error_data.hpp"
+#include "duckdb/main/client_context.hpp"
+#include "notion_metrics.hpp"
+#include "notion_requests.hpp"
+#include "notion_utils.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace duckdb
+{
+
+    //! The default number of query responses fetched ahead of the scan thread. Decoding a page takes far less
+    //! than the round trip of the next request, so two pages in flight keep the scan thread busy.
+    static constexpr idx_t NOTION_DEFAULT_PREFETCH_PAGES = 2;
+
+    //! Walks the pages of one query on a background thread, keeping up to a fixed number of raw responses
+    //! ahead of the scan thread that decodes them. Cursor pagination is serial, so the next request can only
+    //! be sent once the previous response has arrived, but it no longer waits for that response to be decoded.
+    //! The fetcher blocks while the queue is full, so a slow pipeline holds at most that many responses.
+    class NotionPagePrefetcher
+    {
+    public:
+        /**
+         * Starts fetching the first page
+         * @param api The token, headers and pools of the requests
+         * @param database_id The id of the queried database
+         * @param request The body of every query request, without page_size and start_cursor
+         * @param filter_properties The ids of the properties to download
+         * @param depth The number of responses fetched ahead of the consumer
+         * @param scan_metrics The counters of the scan the requests count towards
+         */
+        NotionPagePrefetcher(ClientContext &context, shared_ptr<NotionApiContext> api, std::string database_id, json request,
+                             vector<string> filter_properties, idx_t depth, NotionMetrics &scan_metrics);
+        //! Stops the fetcher, dropping the responses that have not been consumed
+        ~NotionPagePrefetcher();
+
+        //! Waits for the next response of the query
+        //! @return false once every page has been consumed
+        //! @throws The error the request of the next page failed with
+        bool Next(std::string &response);
+
+    private:
+        void Fetch();
+        //! Ends the fetcher, passing the error to the consumer
+        void Fail(ErrorData failure);
+
+    private:
+        //! Only its interrupted flag is read on the fetcher thread
+        ClientContext &context;
+        //! A copy of the scan's context whose waits end once the prefetcher is stopped
+        NotionApiContext api;
+        std::string database_id;
+        json request;
+        vector<string> filter_properties;
+        idx_t depth;
+        NotionMetrics &scan_metrics;
+
+        std::mutex lock;
+        //! Signalled when a response is queued or the fetcher has finished
+        std::condition_variable response_available;
+        //! Signalled when a response has been taken off the queue or the prefetcher is stopped
+        std::condition_variable space_available;
+        std::deque<std::string> responses;
+        //! Set once the last page has been fetched or a request has failed
+        bool finished = false;
+        bool stopped = false;
+        //! Set along with stopped, read by the fetcher thread while it waits on the rate limiter or a retry
+        std::atomic<bool> cancelled {false};
+        ErrorData error;
+        std::thread fetcher;
+    };
+
+} // namespace duckdb
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/common/types/value.hpp"
+#include "notion_utils.hpp"
+
+namespace duckdb
+{
+
+    /**
+     * Converts a value into a page property value of a create or update page request.
+     * @param value The value, which is cast to what the property type needs. A LIST or a comma separated
+     *              string for properties holding several entries, e.g. multi_select.
+     * @return The property value object, e.g. {"number": 3}. NULL clears the property.
+     */
+    typedef json (*notion_property_encoder_t)(const Value &value);
+
+    /**
+     * Returns the encoder for a property type, the counterpart of get_notion_column_writer.
+     * @param type The Notion property type
+     * @return The encoder, or nullptr for types that can't be written such as formula, rollup or created_time
+     */
+    notion_property_encoder_t get_notion_property_encoder(NotionPropertyType type);
+
+} // namespace duckdb
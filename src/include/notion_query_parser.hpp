@@ -0,0 +1,57 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/common/types/data_chunk.hpp"
+#include "notion_utils.hpp"
+#include "notion_column_writer.hpp"
+#include <string>
+#include <unordered_map>
+
+namespace duckdb
+{
+
+    //! Where the values of a query response go in the output chunk of a scan
+    struct NotionResponseLayout
+    {
+        //! The output column of every projected property, by property name
+        std::unordered_map<std::string, idx_t> property_columns;
+        //! The output column of every projected page field, by its key in the page object
+        std::unordered_map<std::string, idx_t> page_field_columns;
+        //! The writer of every output column, null for columns not filled from the response (the row id)
+        vector<notion_column_writer_t> column_writers;
+    };
+
+    struct NotionQueryPage
+    {
+        //! The number of rows written to the output
+        idx_t row_count = 0;
+        bool has_more = false;
+        std::string next_cursor;
+    };
+
+    /**
+     * Decodes a /query response straight into the output chunk. The response is parsed as a stream of
+     * SAX events: only the projected property values are materialized, one small value at a time, and
+     * handed to their column writer, while every other field of the response is skipped unparsed.
+     * @param response The body of the query response
+     * @param layout The output column of every projected property and page field
+     * @param output The chunk to write the rows to
+     * @param row_offset The first row of the chunk to write
+     * @param capacity The maximum number of rows that may be written
+     * @return The number of rows written and the pagination state of the query
+     * @throws IOException if the response is not a valid query response
+     */
+    NotionQueryPage notion_parse_query_response(const std::string &response, const NotionResponseLayout &layout,
+                                                DataChunk &output, idx_t row_offset, idx_t capacity);
+
+    /**
+     * Reads the pagination state of a query response without decoding its results, so the next page can be
+     * requested before this one is decoded. Notion sends next_cursor and has_more after the results array,
+     * so they are looked up from the end of the response, falling back to a full parse when they are not there.
+     * @param response The body of the query response
+     * @param next_cursor The cursor of the next page, set to empty on the last page
+     * @return Whether Notion has more pages
+     */
+    bool notion_peek_pagination(const std::string &response, std::string &next_cursor);
+
+} // namespace duckdb
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/storage/object_cache.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+
+namespace duckdb
+{
+
+    //! Notion's documented average rate limit per integration
+    static constexpr double NOTION_DEFAULT_REQUESTS_PER_SECOND = 3.0;
+    //! The number of requests that can be sent back to back after an idle period
+    static constexpr int64_t NOTION_DEFAULT_REQUEST_BURST = 3;
+    static constexpr int64_t NOTION_DEFAULT_MAX_RETRIES = 5;
+    static constexpr int64_t NOTION_DEFAULT_RETRY_BASE_DELAY_MS = 500;
+    static constexpr int64_t NOTION_DEFAULT_RETRY_MAX_DELAY_MS = 30000;
+
+    //! A token bucket shared by every request made with one integration token in a database instance,
+    //! so concurrent scans and queries together stay within Notion's rate limit. Callers reserve a slot
+    //! up front and sleep outside the lock, which hands out slots in FIFO order at exactly the
+    //! configured rate.
+    class NotionRateLimiter : public ObjectCacheEntry
+    {
+    public:
+        NotionRateLimiter();
+
+        //! Returns the limiter of the database instance for the given token, creating it on first use
+        static shared_ptr<NotionRateLimiter> Get(ClientContext &context, const std::string &token);
+
+        static string ObjectType()
+        {
+            return "notion_rate_limiter";
+        }
+
+        string GetObjectType() override
+        {
+            return ObjectType();
+        }
+
+        //! Blocks until a request may be sent. The rate and burst are passed on every call so changes
+        //! to the settings take effect immediately.
+        void Acquire(ClientContext &context, double requests_per_second, idx_t burst,
+                     const std::atomic<bool> *cancelled = nullptr);
+
+        //! Holds back every request until the delay has passed, e.g. after a 429 with a Retry-After
+        void Pause(std::chrono::milliseconds delay);
+
+    private:
+        std::mutex lock;
+        //! The available requests. Negative when slots have been reserved ahead of time.
+        double tokens;
+        std::chrono::steady_clock::time_point last_refill;
+        //! No request is sent before this point in time
+        std::chrono::steady_clock::time_point paused_until;
+    };
+
+    //! Sleeps for the given duration in short steps, throwing if the query is interrupted or, when given,
+    //! the cancelled flag is set meanwhile
+    void notion_interruptible_sleep(ClientContext &context, std::chrono::steady_clock::duration duration,
+                                    const std::atomic<bool> *cancelled = nullptr);
+
+} // namespace duckdb
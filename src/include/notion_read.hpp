@@ -2,21 +2,161 @@
 
 #include "duckdb.hpp"
 #include "duckdb/function/table_function.hpp"
+#include "duckdb/function/replacement_scan.hpp"
 #include "duckdb/common/types/data_chunk.hpp"
 #include "duckdb/main/client_context.hpp"
+#include "notion_utils.hpp"
+#include "notion_column_writer.hpp"
+#include "notion_query_parser.hpp"
+#include "notion_page_cache.hpp"
+#include "notion_metrics.hpp"
+#include "notion_page_prefetcher.hpp"
+#include "notion_buffer_pool.hpp"
+#include "notion_requests.hpp"
+#include <atomic>
 
 namespace duckdb
 {
 
+    //! The maximum number of pages Notion returns for a single query request
+    static constexpr idx_t NOTION_MAX_PAGE_SIZE = 100;
+    //! The cardinality estimate of a database with more pages than one request returns, until a scan counts them
+    static constexpr idx_t NOTION_UNCOUNTED_ROW_ESTIMATE = 10000;
+    //! The columns added by page_metadata := true
+    static constexpr const char *NOTION_PAGE_ID_COLUMN = "_notion_page_id";
+    static constexpr const char *NOTION_LAST_EDITED_TIME_COLUMN = "_notion_last_edited_time";
+
     struct NotionReadFunctionData : public TableFunctionData
     {
         string database_id;
+        //! The token of the secret the database is read with, looked up once at bind time
+        string token;
+        //! The database properties, in the order they are exposed as columns
+        vector<NotionProperty> properties;
+        //! The typed writer of every property, resolved from the property type at bind time
+        vector<notion_column_writer_t> column_writers;
+        //! The type of every column
+        vector<LogicalType> types;
+        //! The part of the WHERE clause Notion can evaluate, set by the filter pushdown. Notion only pre-filters
+        //! the pages with it, the filters themselves stay in the plan.
+        json pushed_filter;
+        //! The "sorts" of every query request, set when an ORDER BY ... LIMIT is pushed into the scan
+        json sorts = json::array();
+        //! The maximum number of rows the scan has to produce, set when a LIMIT is pushed into the scan
+        idx_t row_limit = DConstants::INVALID_INDEX;
+        //! The number of slices the database is split into for a parallel scan
+        idx_t partitions = 1;
+        //! The date or created_time property slices are taken on. INVALID_INDEX slices on the page's created_time.
+        idx_t partition_property = DConstants::INVALID_INDEX;
+        //! The condition on last_edited_time set by since := TIMESTAMP, null to read every page
+        json since_filter;
+        //! The Notion filter object set by filter := '...', evaluated by Notion only
+        json user_filter;
 
         explicit NotionReadFunctionData(std::string database_id_p) : database_id(std::move(database_id_p)) {}
+
+        //! Tables of an attached workspace hand every query a copy of the bind data of their schema
+        unique_ptr<FunctionData> Copy() const override
+        {
+            return make_uniq<NotionReadFunctionData>(*this);
+        }
+    };
+
+    //! The pagination state of one query. A cursor is only ever walked by one thread at a time.
+    struct NotionScanCursor
+    {
+        //! The "filter" of every request of this query
+        json filter;
+        //! The cursor to pass as start_cursor for the next request, empty for the first page
+        string next_cursor;
+        //! Whether Notion has more pages after the last one fetched
+        bool has_more = true;
+        //! The number of rows returned by Notion so far
+        idx_t rows_fetched = 0;
+        //! Fetches the pages ahead of the thread decoding them, null when each page is requested on demand
+        unique_ptr<NotionPagePrefetcher> prefetcher;
+    };
+
+    struct NotionReadGlobalState : public GlobalTableFunctionState
+    {
+        string token;
+        //! The property index of every output column, or COLUMN_IDENTIFIER_ROW_ID
+        vector<column_t> column_ids;
+        //! The ids of the projected properties, sent as filter_properties so nothing else is downloaded
+        vector<string> filter_properties;
+        //! The output column and writer of every projected property, used to decode responses
+        NotionResponseLayout layout;
+        //! The conditions of the WHERE clause Notion can evaluate. DuckDB filters the rows again, so conditions
+        //! that don't fit in a request can be left out.
+        json pushed_filter;
+        //! The conditions of since := and filter :=, which have to be part of every request
+        vector<json> required_filters;
+        //! The filter of a scan that isn't partitioned, combining the two
+        json query_filter;
+        //! The "filter" of every slice of the scan. Slices are disjoint and together cover the whole query.
+        vector<json> slice_filters;
+        //! The next slice to hand out to a thread
+        std::atomic<idx_t> next_slice{0};
+        //! The number of rows emitted so far, used to fill the row id column
+        std::atomic<idx_t> rows_emitted{0};
+        //! The number of pages read from Notion or the page cache, before the table filters
+        std::atomic<idx_t> rows_fetched{0};
+        //! The number of slices read to the end
+        std::atomic<idx_t> slices_finished{0};
+        //! The number of responses each cursor fetches ahead of the scan thread, 0 to request pages on demand
+        idx_t prefetch_pages = NOTION_DEFAULT_PREFETCH_PAGES;
+        //! The number of pages the scan is expected to read, INVALID_INDEX if unknown. Drives the progress bar.
+        idx_t estimated_rows = DConstants::INVALID_INDEX;
+        //! Set when the scan is served from the local page cache instead of Notion
+        unique_ptr<NotionPageCache> page_cache;
+        //! The API traffic of this scan, kept as the last scan of the instance once the scan is done
+        NotionMetrics metrics;
+        shared_ptr<NotionInstanceMetrics> instance_metrics;
+        //! The headers, connection pool and rate limiter of the requests, shared by the threads of the scan
+        shared_ptr<NotionApiContext> api;
+
+        ~NotionReadGlobalState() override;
+
+        idx_t MaxThreads() const override
+        {
+            // The cached rows are read through a single query result
+            return page_cache ? 1 : slice_filters.size();
+        }
     };
 
+    struct NotionReadLocalState : public LocalTableFunctionState
+    {
+        //! The slice this thread is reading, null before its first and after the last slice
+        unique_ptr<NotionScanCursor> cursor;
+    };
+
+    unique_ptr<GlobalTableFunctionState> notion_init_global(ClientContext &context, TableFunctionInitInput &input);
+
+    unique_ptr<LocalTableFunctionState> notion_init_local(ExecutionContext &context, TableFunctionInitInput &input,
+                                                          GlobalTableFunctionState *global_state);
+
     void notion_read_function(ClientContext &context, TableFunctionInput &data_p, DataChunk &output);
 
     unique_ptr<FunctionData> notion_bind_function(ClientContext &context, TableFunctionBindInput &input,
                                                   vector<LogicalType> &return_types, vector<string> &names);
-} // namespace duckdb
\ No newline at end of file
+
+    /**
+     * Binds a scan of a database, as read_notion does with its named parameters. Also used to bind the tables
+     * of an attached workspace.
+     * @param database_id The id of the database
+     * @param options The read_notion options, e.g. page_metadata
+     * @param return_types The column types, filled in
+     * @param names The column names, filled in
+     * @return The bind data of the scan
+     */
+    unique_ptr<NotionReadFunctionData> notion_bind_database(ClientContext &context, const std::string &database_id,
+                                                            const named_parameter_map_t &options,
+                                                            vector<LogicalType> &return_types, vector<string> &names);
+
+    //! The read_notion table function
+    TableFunction notion_read_table_function();
+
+    //! Turns FROM 'https://www.notion.so/...' into a read_notion scan of the database
+    unique_ptr<TableRef> notion_replacement_scan(ClientContext &context, ReplacementScanInput &input,
+                                                 optional_ptr<ReplacementScanData> data);
+} // namespace duckdb
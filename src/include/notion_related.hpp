@@ -0,0 +1,94 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/storage/object_cache.hpp"
+#include "notion_utils.hpp"
+#include "notion_column_writer.hpp"
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace duckdb
+{
+
+    //! The number of page objects kept for read_notion_related, across all tokens
+    static constexpr idx_t NOTION_DEFAULT_RELATED_PAGE_CACHE_SIZE = 10000;
+    //! How long a cached page object is used before it is fetched again
+    static constexpr int64_t NOTION_DEFAULT_RELATED_PAGE_CACHE_TTL_SECONDS = 60;
+    //! The default number of page lookups in flight at once
+    static constexpr idx_t NOTION_DEFAULT_RELATED_CONCURRENCY = 4;
+    //! The column holding the id of the related page, next to NOTION_PAGE_ID_COLUMN
+    static constexpr const char *NOTION_RELATED_PAGE_ID_COLUMN = "_notion_related_page_id";
+
+    //! The page objects returned by GET /v1/pages, shared by every read_notion_related of the database instance.
+    //! Projects link to the same tasks over and over, so recently used pages are kept up to a fixed count.
+    class NotionPageLRU : public ObjectCacheEntry
+    {
+    public:
+        //! Returns the cache of the database instance, creating it on first use
+        static shared_ptr<NotionPageLRU> Get(ClientContext &context);
+
+        static string ObjectType()
+        {
+            return "notion_page_lru";
+        }
+
+        string GetObjectType() override
+        {
+            return ObjectType();
+        }
+
+        //! Returns the page fetched with the token, or null if it is not cached or older than max_age
+        shared_ptr<const json> Lookup(const std::string &token, const std::string &page_id, std::chrono::seconds max_age);
+
+        //! Adds a page, evicting the least recently used pages beyond the capacity
+        void Insert(const std::string &token, const std::string &page_id, shared_ptr<const json> page, idx_t capacity);
+
+        //! Drops every cached page
+        void Clear();
+
+    private:
+        struct Entry
+        {
+            std::string key;
+            shared_ptr<const json> page;
+            std::chrono::steady_clock::time_point fetched_at;
+        };
+
+        static std::string Key(const std::string &token, const std::string &page_id);
+
+        std::mutex lock;
+        //! The entries, most recently used first
+        std::list<Entry> entries;
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    };
+
+    struct NotionRelatedFunctionData : public TableFunctionData
+    {
+        string database_id;
+        //! The token of the secret the relation is read with, looked up once at bind time
+        string token;
+        //! The relation property of the database, by name and by id
+        string relation_name;
+        string relation_id;
+        //! The database the relation points to
+        string related_database_id;
+        //! The properties of the related database, in the order they follow the page id columns
+        vector<string> property_names;
+        vector<notion_column_writer_t> column_writers;
+        idx_t concurrency = NOTION_DEFAULT_RELATED_CONCURRENCY;
+    };
+
+    /**
+     * read_notion_related('database', 'relation property') returns one row per edge of a relation, with the id of
+     * the page and of the related page followed by the properties of the related page. The relation is read with
+     * an id-only scan of the database; relations with more entries than a page object holds are paginated through
+     * the page property endpoint. Every related page is then looked up once, concurrently, unless it is cached. The
+     * properties of a related page that was deleted or isn't shared with the integration are NULL.
+     */
+    TableFunction notion_read_related_table_function();
+
+} // namespace duckdb
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/main/client_context.hpp"
+#include "notion_requests.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace duckdb
+{
+
+    //! The default number of write requests in flight at once. Notion takes a few hundred milliseconds per
+    //! write, so a handful of concurrent requests is enough to keep up with the rate limit.
+    static constexpr idx_t NOTION_DEFAULT_WRITE_CONCURRENCY = 4;
+
+    struct NotionPendingRequest
+    {
+        //! The input row the request was built from, used to report errors
+        idx_t row;
+        HttpMethod method;
+        std::string path;
+        std::string body;
+    };
+
+    struct NotionRequestError
+    {
+        idx_t row;
+        std::string message;
+    };
+
+    //! Sends write requests through a fixed number of worker threads so several are in flight at once,
+    //! while the rate limiter shared by call_notion_api keeps them within Notion's limit. Submitting
+    //! blocks while the queue is full, so rows are converted no faster than they can be sent.
+    class NotionRequestDispatcher
+    {
+    public:
+        NotionRequestDispatcher(ClientContext &context, shared_ptr<NotionApiContext> api, idx_t concurrency);
+        //! Stops the workers, dropping requests that have not been sent yet
+        ~NotionRequestDispatcher();
+
+        //! Queues a request, blocking while the queue is full
+        void Submit(NotionPendingRequest request);
+
+        //! Records the row as failed without sending a request for it
+        void Fail(idx_t row, std::string message);
+
+        //! Waits until every queued request has been sent
+        //! @return The failed requests, ordered by row
+        vector<NotionRequestError> Finish();
+
+        //! The number of requests that completed successfully
+        idx_t Succeeded();
+
+    private:
+        void Work();
+        void Stop();
+
+    private:
+        ClientContext &context;
+        //! The token, settings and pools shared by every worker
+        shared_ptr<NotionApiContext> api;
+        //! Set when the dispatcher stops, ends the waits of requests in flight
+        std::atomic<bool> cancelled{false};
+        idx_t max_queued;
+
+        std::mutex lock;
+        //! Signalled when a request is queued or the dispatcher is stopped
+        std::condition_variable request_available;
+        //! Signalled when a request has been taken off the queue or completed
+        std::condition_variable request_done;
+        std::deque<NotionPendingRequest> queue;
+        idx_t in_flight = 0;
+        bool stopped = false;
+        idx_t succeeded = 0;
+        vector<NotionRequestError> errors;
+        vector<std::thread> workers;
+    };
+
+    /**
+     * Sends GET requests through a fixed number of threads and collects their responses. Like the dispatcher,
+     * the threads share the rate limiter of call_notion_api.
+     * @param api The context of the operation the requests belong to
+     * @param paths The paths to request
+     * @param concurrency The number of requests in flight at once
+     * @param missing_as_empty Whether an object that doesn't exist or isn't shared with the integration (404 or 403)
+     *                         gets an empty response rather than failing the call
+     * @return The response of every path, in the order of the paths
+     * @throws The first error any request failed with
+     */
+    vector<std::string> notion_get_concurrently(ClientContext &context, const NotionApiContext &api,
+                                                const vector<std::string> &paths, idx_t concurrency,
+                                                bool missing_as_empty = false);
+
+} // namespace duckdb
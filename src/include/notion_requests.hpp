@@ -1,11 +1,24 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <vector>
+#include "duckdb/main/client_context.hpp"
+#include "duckdb/common/exception.hpp"
+#include "notion_utils.hpp"
 
 namespace duckdb
 {
 
+    //! The Notion API endpoint, overridden with the notion_api_host, notion_api_port and notion_api_use_tls
+    //! settings to point the extension at a local mock server
+    static constexpr const char *NOTION_DEFAULT_API_HOST = "api.notion.com";
+    static constexpr int64_t NOTION_DEFAULT_API_PORT = 443;
+    static constexpr bool NOTION_DEFAULT_API_USE_TLS = true;
+    //! Certificates have never been verified, so turning verification on by default could break setups
+    //! whose OpenSSL has no usable CA store
+    static constexpr bool NOTION_DEFAULT_API_VERIFY_TLS = false;
+
     enum class HttpMethod
     {
         GET,
@@ -15,12 +28,56 @@ namespace duckdb
         DELETE
     };
 
-    std::string call_notion_api(const std::string &token, HttpMethod method, const std::string &path, const std::string &body);
-    std::string get_database(const std::string &token, const std::string &database_id);
-    std::string query_database(const std::string &token, const std::string &database_id);
+    class NotionConnectionPool;
+    class NotionRateLimiter;
+    class NotionBufferPool;
+    class NotionInstanceMetrics;
+
+    //! Everything a request needs besides its method, path and body: the token and headers, the retry settings,
+    //! and the connection pool and rate limiter to use. Resolved once per scan or COPY and shared by its threads, so
+    //! the settings and pools are not looked up again for every page.
+    struct NotionApiContext
+    {
+        NotionApiContext(ClientContext &context, std::string token);
+
+        std::string token;
+        //! The Host, Authorization and Notion-Version headers, each terminated by CRLF
+        std::string headers;
+        double requests_per_second;
+        int64_t burst;
+        int64_t max_retries;
+        int64_t base_delay_ms;
+        int64_t max_delay_ms;
+        shared_ptr<NotionConnectionPool> pool;
+        //! The limiter of the token, so every integration has a budget of its own
+        shared_ptr<NotionRateLimiter> limiter;
+        shared_ptr<NotionBufferPool> buffers;
+        //! The counters of the database instance every request is recorded in
+        shared_ptr<NotionInstanceMetrics> metrics;
+        //! When set, waiting for the rate limiter or a retry stops with an InterruptException, e.g. once
+        //! the prefetcher making the requests is stopped
+        const std::atomic<bool> *cancelled = nullptr;
+    };
+
+    //! Thrown by call_notion_api when Notion answers with an error status, e.g. 404 for a page that doesn't
+    //! exist or isn't shared with the integration
+    class NotionApiException : public IOException
+    {
+    public:
+        NotionApiException(const std::string &message, int status) : IOException(message), status(status)
+        {
+        }
+
+        int status;
+    };
+
+    //! The body is read into a buffer of the NotionBufferPool, callers decoding many pages hand it back with Release
+    std::string call_notion_api(ClientContext &context, const NotionApiContext &api, HttpMethod method,
+                                const std::string &path, const std::string &body);
+    std::string get_database(ClientContext &context, const NotionApiContext &api, const std::string &database_id);
+    std::string query_database(ClientContext &context, const NotionApiContext &api, const std::string &database_id,
+                               const std::string &body, const std::vector<std::string> &filter_properties = {});
 
-    // std::string list_databases(const std::string &token);
-    // std::string create_page(const std::string &token, const std::string &database_id, const std::string &body);
-    // std::string update_page_properties(const std::string &token, const std::string &page_id, const std::string &body);
+    std::vector<json> list_databases(ClientContext &context, const NotionApiContext &api);
 
 } // namespace duckdb
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/function/table_function.hpp"
+#include "duckdb/storage/object_cache.hpp"
+#include "notion_utils.hpp"
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace duckdb
+{
+    struct NotionApiContext;
+
+    //! How long a cached database object is used before it is revalidated
+    static constexpr int64_t NOTION_DEFAULT_SCHEMA_CACHE_TTL_SECONDS = 300;
+
+    //! Caches the database objects returned by GET /v1/databases, so binding read_notion does not hit
+    //! the API on every statement. There is one cache per database instance, keyed by database id and
+    //! token since different integrations may see different databases.
+    class NotionSchemaCache : public ObjectCacheEntry
+    {
+    public:
+        //! Returns the cache of the database instance, creating it on first use
+        static shared_ptr<NotionSchemaCache> Get(ClientContext &context);
+
+        static string ObjectType()
+        {
+            return "notion_schema_cache";
+        }
+
+        string GetObjectType() override
+        {
+            return ObjectType();
+        }
+
+        //! Returns the database object, fetching it when it is not cached or older than the
+        //! notion_schema_cache_ttl setting
+        shared_ptr<const json> GetDatabase(ClientContext &context, const NotionApiContext &api, const std::string &database_id);
+
+        //! Caches a database object obtained some other way, e.g. from a search
+        void StoreDatabase(const std::string &token, const std::string &database_id, shared_ptr<const json> database);
+
+        //! Returns the number of pages of the database as of its last complete scan, or of a probe when it
+        //! hasn't been scanned yet. INVALID_INDEX when neither happened.
+        //! @param is_lower_bound Set when the count is only a lower bound, from a probe that didn't see every page
+        idx_t GetRowCount(const std::string &token, const std::string &database_id, bool &is_lower_bound);
+
+        //! Records the page count of a cached database, ignored when the database isn't cached
+        void StoreRowCount(const std::string &token, const std::string &database_id, idx_t row_count,
+                           bool is_lower_bound = false);
+
+        //! Drops every cached database object
+        void Clear();
+
+    private:
+        static std::string Key(const std::string &token, const std::string &database_id);
+
+        struct Entry
+        {
+            shared_ptr<const json> database;
+            std::chrono::steady_clock::time_point validated_at;
+            //! Kept when the database object is refetched, a schema change rarely changes the page count
+            idx_t row_count = DConstants::INVALID_INDEX;
+            bool row_count_is_lower_bound = false;
+        };
+
+        std::mutex lock;
+        std::unordered_map<std::string, Entry> entries;
+    };
+
+    /**
+     * notion_clear_cache() drops everything the extension has cached for the database instance, so the next
+     * read_notion binds against the current schema of every database and fetches every page in full.
+     */
+    TableFunction notion_clear_cache_table_function();
+
+} // namespace duckdb
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/function/table_function.hpp"
+
+namespace duckdb
+{
+
+    struct NotionSyncFunctionData : public TableFunctionData
+    {
+        string database_id;
+        //! The local table, quoted and qualified as given
+        string table_name;
+        //! Whether pages that disappeared from the database (archived or trashed) are deleted locally, which
+        //! costs a scan of every page id in the database
+        bool detect_deletes = false;
+    };
+
+    struct NotionSyncGlobalState : public GlobalTableFunctionState
+    {
+        bool finished = false;
+    };
+
+    /**
+     * notion_sync('database', 'local_table') brings a local copy of a Notion database up to date. The table
+     * is created with read_notion's columns plus the page metadata columns on first use. Afterwards only
+     * pages edited since the largest stored last_edited_time are fetched and merged by page id. Pages that
+     * were archived or moved to the trash are no longer returned by Notion. With detect_deletes := true they
+     * are found with an id-only scan of the whole database and deleted locally. Returns a single row with the number of inserted, updated and deleted pages
+     * and the new watermark.
+     */
+    TableFunction notion_sync_table_function();
+
+} // namespace duckdb
@@ -5,6 +5,7 @@
 #include <json.hpp>
 #include <random>
 #include <functional>
+#include "duckdb/common/types/timestamp.hpp"
 
 using json = nlohmann::json;
 
@@ -34,13 +35,18 @@ namespace duckdb
         STATUS,
         TITLE,
         URL,
+        //! Any property type the extension does not know about (e.g. button or unique_id)
+        UNKNOWN,
     };
 
     struct NotionProperty
     {
+        //! The property id, or the key in the page object for page fields
         std::string id;
         std::string name;
         NotionPropertyType type;
+        //! Whether the value is a field of the page object itself (e.g. its id) rather than one of its properties
+        bool page_field = false;
     };
 
     struct NotionPropertyItem
@@ -58,10 +64,40 @@ namespace duckdb
      */
     std::string extract_database_id(const std::string &input);
 
+    /**
+     * Maps the "type" field of a Notion property object to a NotionPropertyType
+     * @param type The Notion property type name, e.g. "rich_text"
+     * @return The matching NotionPropertyType, or UNKNOWN for unsupported types
+     */
+    NotionPropertyType parse_notion_property_type(const std::string &type);
+
+    /**
+     * Finds a property of a database schema by name, matching exactly first and then ignoring case
+     * @param properties The "properties" object of the database
+     * @param name The property name
+     * @return The property object, or nullptr if there is no such property
+     */
+    const json *find_notion_property(const json &properties, const std::string &name);
+
+    /**
+     * Formats a timestamp the way the Notion API expects it, e.g. 2024-01-31T09:30:00Z
+     * @param timestamp The timestamp, in UTC
+     * @return The ISO 8601 representation of the timestamp
+     */
+    std::string notion_timestamp_to_iso8601(timestamp_t timestamp);
+
+    /**
+     * Escapes the raw newlines and tabs and drops the other control characters, which are not valid in JSON strings
+     * @param json_str The JSON string
+     * @return A copy of the string without control characters
+     */
+    std::string clean_json_control_characters(const std::string &json_str);
+
     /**
      * Parses a JSON string into a json object
      * @param json_str The JSON string
      * @return The parsed json object
+     * @throws IOException quoting the start of the string if it isn't valid JSON
      */
     json parse_json(const std::string &json_str);
 
@@ -3,6 +3,7 @@
 #include "notion_utils.hpp"
 #include "duckdb/common/exception.hpp"
 #include "duckdb/main/secret/secret.hpp"
+#include "duckdb/main/secret/secret_manager.hpp"
 #include "duckdb/main/extension_util.hpp"
 #include <fstream>
 #include <cstdlib>
@@ -22,6 +23,49 @@ namespace duckdb
         return token;
     }
 
+    static std::string get_token_from_secret(const BaseSecret &secret)
+    {
+        if (secret.GetType() != "notion")
+        {
+            throw InvalidInputException("Invalid secret type. Expected 'notion', got '%s'", secret.GetType());
+        }
+
+        const auto *kv_secret = dynamic_cast<const KeyValueSecret *>(&secret);
+        if (!kv_secret)
+        {
+            throw InvalidInputException("Invalid secret format for 'notion' secret");
+        }
+
+        Value token_value;
+        if (!kv_secret->TryGetValue("token", token_value))
+        {
+            throw InvalidInputException("'token' not found in 'notion' secret");
+        }
+        return token_value.ToString();
+    }
+
+    std::string get_notion_token(ClientContext &context, const std::string &secret_name)
+    {
+        auto &secret_manager = SecretManager::Get(context);
+        auto transaction = CatalogTransaction::GetSystemCatalogTransaction(context);
+        if (!secret_name.empty())
+        {
+            auto secret_entry = secret_manager.GetSecretByName(transaction, secret_name);
+            if (!secret_entry)
+            {
+                throw InvalidInputException("No secret named '%s' found", secret_name);
+            }
+            return get_token_from_secret(*secret_entry->secret);
+        }
+
+        auto secret_match = secret_manager.LookupSecret(transaction, "notion", "notion");
+        if (!secret_match.HasMatch())
+        {
+            throw InvalidInputException("No 'notion' secret found. Please create a secret with 'CREATE SECRET' first.");
+        }
+        return get_token_from_secret(secret_match.GetSecret());
+    }
+
     // This code is copied, with minor modifications from https://github.com/duckdb/duckdb_azure/blob/main/src/azure_secret.cpp
     static void CopySecret(const std::string &key, const CreateSecretInput &input, KeyValueSecret &result)
     {
@@ -0,0 +1,385 @@
+#include "notion_blocks.hpp"
+#include "notion_auth.hpp"
+#include "notion_read.hpp"
+#include "notion_requests.hpp"
+#include "notion_schema_cache.hpp"
+#include "notion_utils.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/string_util.hpp"
+
+namespace duckdb
+{
+
+    static LogicalType rich_text_type()
+    {
+        return LogicalType::LIST(LogicalType::STRUCT({{"plain_text", LogicalType::VARCHAR},
+                                                      {"href", LogicalType::VARCHAR},
+                                                      {"bold", LogicalType::BOOLEAN},
+                                                      {"italic", LogicalType::BOOLEAN},
+                                                      {"strikethrough", LogicalType::BOOLEAN},
+                                                      {"underline", LogicalType::BOOLEAN},
+                                                      {"code", LogicalType::BOOLEAN},
+                                                      {"color", LogicalType::VARCHAR}}));
+    }
+
+    static unique_ptr<FunctionData> notion_blocks_bind(ClientContext &context, TableFunctionBindInput &input,
+                                                       vector<LogicalType> &return_types, vector<string> &names)
+    {
+        auto result = make_uniq<NotionBlocksFunctionData>();
+        result->id = extract_database_id(input.inputs[0].GetValue<string>());
+        std::string secret_name;
+        for (auto &kv : input.named_parameters)
+        {
+            if (StringUtil::Lower(kv.first) == "max_depth")
+            {
+                auto max_depth = kv.second.GetValue<int64_t>();
+                if (max_depth < 0)
+                {
+                    throw BinderException("read_notion_blocks: max_depth can't be negative");
+                }
+                result->max_depth = max_depth;
+            }
+            else if (StringUtil::Lower(kv.first) == "secret" && !kv.second.IsNull())
+            {
+                secret_name = StringValue::Get(kv.second);
+            }
+        }
+        result->token = get_notion_token(context, secret_name);
+
+        names = {"page_id", "block_id", "parent_id", "depth", "block_index", "type", "has_children", "plain_text", "rich_text"};
+        return_types = {LogicalType::VARCHAR, LogicalType::VARCHAR, LogicalType::VARCHAR, LogicalType::INTEGER,
+                        LogicalType::BIGINT, LogicalType::VARCHAR, LogicalType::BOOLEAN, LogicalType::VARCHAR,
+                        rich_text_type()};
+        return std::move(result);
+    }
+
+    // Returns the pages to read: the page itself, or every page of a database. Both are blocks, which tells them apart.
+    static vector<string> root_pages(ClientContext &context, const NotionBlocksFunctionData &bind_data,
+                                     const NotionApiContext &api)
+    {
+        auto block = parse_json(call_notion_api(context, api, HttpMethod::GET, "/v1/blocks/" + bind_data.id, ""));
+        if (block.value("type", "") != "child_database")
+        {
+            return {bind_data.id};
+        }
+
+        // Only the title is projected, the smallest payload a query returns
+        vector<string> filter_properties;
+        auto database = NotionSchemaCache::Get(context)->GetDatabase(context, api, bind_data.id);
+        for (auto &property : (*database)["properties"])
+        {
+            if (property["type"] == "title")
+            {
+                filter_properties.push_back(property["id"].get<std::string>());
+            }
+        }
+
+        vector<string> pages;
+        std::string next_cursor;
+        do
+        {
+            json request_body = {{"page_size", NOTION_MAX_PAGE_SIZE}};
+            if (!next_cursor.empty())
+            {
+                request_body["start_cursor"] = next_cursor;
+            }
+            auto response = parse_json(query_database(context, api, bind_data.id, request_body.dump(), filter_properties));
+            for (auto &page : response["results"])
+            {
+                pages.push_back(page["id"].get<std::string>());
+            }
+            next_cursor = response.value("has_more", false) ? response["next_cursor"].get<std::string>() : "";
+        } while (!next_cursor.empty());
+        return pages;
+    }
+
+    static unique_ptr<GlobalTableFunctionState> notion_blocks_init_global(ClientContext &context, TableFunctionInitInput &input)
+    {
+        auto &bind_data = input.bind_data->Cast<NotionBlocksFunctionData>();
+        auto result = make_uniq<NotionBlocksGlobalState>();
+        result->api = make_shared_ptr<NotionApiContext>(context, bind_data.token);
+        result->column_ids = input.column_ids;
+
+        auto pages = root_pages(context, bind_data, *result->api);
+        // A single page still fans out into child blocks, which idle threads steal, so the queue count doesn't
+        // depend on the number of root pages
+        for (idx_t i = 0; i < NOTION_BLOCKS_MAX_THREADS; i++)
+        {
+            result->queues.push_back(make_uniq<NotionBlockQueue>());
+        }
+        // Pages are dealt out round robin, threads steal from each other once their own are done
+        for (idx_t i = 0; i < pages.size(); i++)
+        {
+            result->queues[i % NOTION_BLOCKS_MAX_THREADS]->tasks.push_back({pages[i], pages[i], 0});
+        }
+        result->pending = pages.size();
+        result->queued = pages.size();
+        return std::move(result);
+    }
+
+    static unique_ptr<LocalTableFunctionState> notion_blocks_init_local(ExecutionContext &context, TableFunctionInitInput &input,
+                                                                        GlobalTableFunctionState *global_state)
+    {
+        auto &gstate = global_state->Cast<NotionBlocksGlobalState>();
+        auto result = make_uniq<NotionBlocksLocalState>();
+        result->queue_index = gstate.next_queue++ % gstate.queues.size();
+        return std::move(result);
+    }
+
+    // Takes the newest task of the thread's own queue, or else the oldest task of another queue
+    static bool take_task(NotionBlocksGlobalState &gstate, idx_t queue_index, NotionBlockTask &task)
+    {
+        for (idx_t i = 0; i < gstate.queues.size(); i++)
+        {
+            auto &queue = *gstate.queues[(queue_index + i) % gstate.queues.size()];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (queue.tasks.empty())
+            {
+                continue;
+            }
+            if (i == 0)
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            else
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            gstate.queued--;
+            return true;
+        }
+        return false;
+    }
+
+    static void write_string(Vector &result, idx_t row_index, const std::string &str)
+    {
+        FlatVector::GetData<string_t>(result)[row_index] = StringVector::AddString(result, str.data(), str.size());
+    }
+
+    // Writes a field of a rich text run. Struct fields get their validity set explicitly, as a row slot may be
+    // reused after it was set to NULL.
+    static void write_string_field(Vector &field, idx_t row_index, const json *value)
+    {
+        if (!value || !value->is_string())
+        {
+            FlatVector::SetNull(field, row_index, true);
+            return;
+        }
+        FlatVector::Validity(field).SetValid(row_index);
+        write_string(field, row_index, value->get_ref<const std::string &>());
+    }
+
+    // Appends the runs to the child vector of the rich_text list, as STRUCTs of their text and annotations
+    static void write_rich_text(Vector &result, idx_t row_index, const json *runs)
+    {
+        idx_t count = runs && runs->is_array() ? runs->size() : 0;
+        auto offset = ListVector::GetListSize(result);
+        ListVector::Reserve(result, offset + count);
+        auto &child = ListVector::GetEntry(result);
+        auto &fields = StructVector::GetEntries(child);
+        static const json no_annotations = json::object();
+        for (idx_t i = 0; i < count; i++)
+        {
+            auto &run = (*runs)[i];
+            auto index = offset + i;
+            auto annotations = run.find("annotations");
+            auto &flags = annotations != run.end() && annotations->is_object() ? *annotations : no_annotations;
+            auto plain_text = run.find("plain_text");
+            write_string_field(*fields[0], index, plain_text != run.end() ? &*plain_text : nullptr);
+            auto href = run.find("href");
+            write_string_field(*fields[1], index, href != run.end() ? &*href : nullptr);
+            idx_t field_index = 2;
+            for (auto name : {"bold", "italic", "strikethrough", "underline", "code"})
+            {
+                auto &field = *fields[field_index++];
+                FlatVector::Validity(field).SetValid(index);
+                FlatVector::GetData<bool>(field)[index] = flags.value(name, false);
+            }
+            FlatVector::Validity(*fields[7]).SetValid(index);
+            write_string(*fields[7], index, flags.value("color", "default"));
+        }
+        ListVector::SetListSize(result, offset + count);
+        FlatVector::GetData<list_entry_t>(result)[row_index] = list_entry_t(offset, count);
+    }
+
+    // Wakes up the threads waiting for tasks. Taking wait_lock first means a thread that has just found nothing
+    // to do is either already waiting or will see the new state when it checks the predicate.
+    static void notify_workers(NotionBlocksGlobalState &gstate)
+    {
+        {
+            std::lock_guard<std::mutex> guard(gstate.wait_lock);
+        }
+        gstate.work_available.notify_all();
+    }
+
+    // Writes a row for every block of the response and queues the fetches of what comes next: the following
+    // page of children, and the children of every block that has any
+    static idx_t process_children(const NotionBlocksFunctionData &bind_data, NotionBlocksGlobalState &gstate,
+                                  NotionBlocksLocalState &lstate, const NotionBlockTask &task, const json &response,
+                                  DataChunk &output)
+    {
+        vector<NotionBlockTask> next_tasks;
+        if (response.value("has_more", false))
+        {
+            auto next_task = task;
+            next_task.offset += response["results"].size();
+            next_task.cursor = response["next_cursor"].get<std::string>();
+            next_tasks.push_back(std::move(next_task));
+        }
+
+        idx_t row_index = 0;
+        for (auto &block : response["results"])
+        {
+            auto block_id = block["id"].get<std::string>();
+            auto type = block.value("type", "");
+            bool has_children = block.value("has_children", false);
+            // The rows of a child database are pages of their own, not content of this page
+            if (has_children && type != "child_database" &&
+                (bind_data.max_depth == DConstants::INVALID_INDEX || task.depth < bind_data.max_depth))
+            {
+                next_tasks.push_back({task.page_id, block_id, task.depth + 1});
+            }
+
+            const json *runs = nullptr;
+            auto content = block.find(type);
+            if (content != block.end() && content->is_object() && content->contains("rich_text"))
+            {
+                runs = &(*content)["rich_text"];
+            }
+
+            for (idx_t col_index = 0; col_index < gstate.column_ids.size(); col_index++)
+            {
+                auto &result = output.data[col_index];
+                switch (gstate.column_ids[col_index])
+                {
+                case 0:
+                    write_string(result, row_index, task.page_id);
+                    break;
+                case 1:
+                    write_string(result, row_index, block_id);
+                    break;
+                case 2:
+                    write_string(result, row_index, task.block_id);
+                    break;
+                case 3:
+                    FlatVector::GetData<int32_t>(result)[row_index] = static_cast<int32_t>(task.depth);
+                    break;
+                case 4:
+                    FlatVector::GetData<int64_t>(result)[row_index] = static_cast<int64_t>(task.offset + row_index);
+                    break;
+                case 5:
+                    write_string(result, row_index, type);
+                    break;
+                case 6:
+                    FlatVector::GetData<bool>(result)[row_index] = has_children;
+                    break;
+                case 7:
+                {
+                    if (!runs)
+                    {
+                        FlatVector::SetNull(result, row_index, true);
+                        break;
+                    }
+                    std::string text;
+                    for (auto &run : *runs)
+                    {
+                        text += run.value("plain_text", "");
+                    }
+                    write_string(result, row_index, text);
+                    break;
+                }
+                case 8:
+                    write_rich_text(result, row_index, runs);
+                    break;
+                default:
+                    // The row id
+                    FlatVector::SetNull(result, row_index, true);
+                    break;
+                }
+            }
+            row_index++;
+        }
+
+        if (!next_tasks.empty())
+        {
+            auto &queue = *gstate.queues[lstate.queue_index];
+            {
+                std::lock_guard<std::mutex> guard(queue.lock);
+                // Pushed in reverse so the first child is taken first
+                for (auto it = next_tasks.rbegin(); it != next_tasks.rend(); ++it)
+                {
+                    queue.tasks.push_back(std::move(*it));
+                }
+            }
+            gstate.pending += next_tasks.size();
+            gstate.queued += next_tasks.size();
+            notify_workers(gstate);
+        }
+        return row_index;
+    }
+
+    static void notion_blocks_function(ClientContext &context, TableFunctionInput &data_p, DataChunk &output)
+    {
+        auto &bind_data = data_p.bind_data->Cast<NotionBlocksFunctionData>();
+        auto &gstate = data_p.global_state->Cast<NotionBlocksGlobalState>();
+        auto &lstate = data_p.local_state->Cast<NotionBlocksLocalState>();
+
+        while (true)
+        {
+            NotionBlockTask task;
+            if (!take_task(gstate, lstate.queue_index, task))
+            {
+                if (gstate.pending == 0)
+                {
+                    return;
+                }
+                // Other threads are fetching blocks that may have children, wait for them to be queued. The
+                // timeout only serves to notice an interrupted query.
+                std::unique_lock<std::mutex> guard(gstate.wait_lock);
+                while (!gstate.work_available.wait_for(guard, std::chrono::milliseconds(100), [&]()
+                                                       { return gstate.pending == 0 || gstate.queued > 0; }))
+                {
+                    if (context.interrupted)
+                    {
+                        throw InterruptException();
+                    }
+                }
+                continue;
+            }
+
+            auto path = "/v1/blocks/" + task.block_id + "/children?page_size=" + std::to_string(NOTION_MAX_PAGE_SIZE);
+            if (!task.cursor.empty())
+            {
+                path += "&start_cursor=" + url_encode(task.cursor);
+            }
+            auto response = parse_json(call_notion_api(context, *gstate.api, HttpMethod::GET, path, ""));
+            if (!response.contains("results"))
+            {
+                throw IOException("Invalid response from Notion API: no results found");
+            }
+            auto count = process_children(bind_data, gstate, lstate, task, response, output);
+            if (--gstate.pending == 0)
+            {
+                notify_workers(gstate);
+            }
+            if (count > 0)
+            {
+                output.SetCardinality(count);
+                return;
+            }
+        }
+    }
+
+    TableFunction notion_read_blocks_table_function()
+    {
+        TableFunction function("read_notion_blocks", {LogicalType::VARCHAR}, notion_blocks_function, notion_blocks_bind,
+                               notion_blocks_init_global, notion_blocks_init_local);
+        function.named_parameters["max_depth"] = LogicalType::BIGINT;
+        function.named_parameters["secret"] = LogicalType::VARCHAR;
+        function.projection_pushdown = true;
+        return function;
+    }
+
+} // namespace duckdb
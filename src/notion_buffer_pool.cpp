@@ -0,0 +1,71 @@
+#include "notion_buffer_pool.hpp"
+
+namespace duckdb
+{
+
+    // Returns the smallest size class holding buffers of at least the given capacity
+    static idx_t size_class_for(idx_t capacity)
+    {
+        idx_t size_class = NOTION_BUFFER_POOL_MIN_CLASS;
+        while (size_class <= NOTION_BUFFER_POOL_MAX_CLASS && (idx_t(1) << size_class) < capacity)
+        {
+            size_class++;
+        }
+        return size_class;
+    }
+
+    shared_ptr<NotionBufferPool> NotionBufferPool::Get(ClientContext &context)
+    {
+        auto &cache = ObjectCache::GetObjectCache(context);
+        return cache.GetOrCreate<NotionBufferPool>(ObjectType());
+    }
+
+    std::string NotionBufferPool::Acquire(idx_t capacity)
+    {
+        auto size_class = size_class_for(capacity);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            // A buffer of a larger class is better than a new one
+            for (auto i = size_class; i <= NOTION_BUFFER_POOL_MAX_CLASS; i++)
+            {
+                if (!buffers[i].empty())
+                {
+                    auto buffer = std::move(buffers[i].back());
+                    buffers[i].pop_back();
+                    pooled_bytes -= buffer.capacity();
+                    return buffer;
+                }
+            }
+        }
+
+        std::string buffer;
+        buffer.reserve(size_class <= NOTION_BUFFER_POOL_MAX_CLASS ? idx_t(1) << size_class : capacity);
+        return buffer;
+    }
+
+    void NotionBufferPool::Release(std::string buffer)
+    {
+        auto capacity = buffer.capacity();
+        if (capacity < (idx_t(1) << NOTION_BUFFER_POOL_MIN_CLASS) ||
+            capacity >= (idx_t(1) << (NOTION_BUFFER_POOL_MAX_CLASS + 1)))
+        {
+            return;
+        }
+        // The largest class the capacity fully covers
+        auto size_class = size_class_for(capacity);
+        if ((idx_t(1) << size_class) > capacity)
+        {
+            size_class--;
+        }
+
+        buffer.clear();
+        std::lock_guard<std::mutex> guard(lock);
+        if (pooled_bytes + capacity > NOTION_BUFFER_POOL_MAX_BYTES)
+        {
+            return;
+        }
+        pooled_bytes += capacity;
+        buffers[size_class].push_back(std::move(buffer));
+    }
+
+} // namespace duckdb
@@ -0,0 +1,423 @@
+#include "notion_catalog.hpp"
+#include "notion_auth.hpp"
+#include "notion_read.hpp"
+#include "notion_requests.hpp"
+#include "notion_schema_cache.hpp"
+#include "notion_utils.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/parser/parsed_data/create_schema_info.hpp"
+#include "duckdb/parser/parsed_data/create_table_info.hpp"
+#include "duckdb/storage/database_size.hpp"
+#include "duckdb/storage/statistics/base_statistics.hpp"
+#include "duckdb/storage/table_storage_info.hpp"
+
+namespace duckdb
+{
+
+    NotionTableEntry::NotionTableEntry(Catalog &catalog, SchemaCatalogEntry &schema, CreateTableInfo &info,
+                                       unique_ptr<NotionReadFunctionData> bind_data_p, std::string last_edited_time_p)
+        : TableCatalogEntry(catalog, schema, info), database_id(bind_data_p->database_id), bind_data(std::move(bind_data_p)),
+          last_edited_time(std::move(last_edited_time_p))
+    {
+    }
+
+    unique_ptr<BaseStatistics> NotionTableEntry::GetStatistics(ClientContext &context, column_t column_id)
+    {
+        return nullptr;
+    }
+
+    TableFunction NotionTableEntry::GetScanFunction(ClientContext &context, unique_ptr<FunctionData> &bind_data_p)
+    {
+        // The filter and limit pushdowns write to the bind data, so every scan gets its own copy
+        bind_data_p = bind_data->Copy();
+        return notion_read_table_function();
+    }
+
+    TableStorageInfo NotionTableEntry::GetStorageInfo(ClientContext &context)
+    {
+        return TableStorageInfo();
+    }
+
+    NotionSchemaEntry::NotionSchemaEntry(Catalog &catalog, CreateSchemaInfo &info) : SchemaCatalogEntry(catalog, info)
+    {
+    }
+
+    // Returns the plain text of a database title
+    static std::string get_database_title(const json &database)
+    {
+        std::string title;
+        if (database.contains("title") && database["title"].is_array())
+        {
+            for (auto &part : database["title"])
+            {
+                title += part.value("plain_text", "");
+            }
+        }
+        return title;
+    }
+
+    void NotionSchemaEntry::RefreshTableNames(ClientContext &context)
+    {
+        int64_t ttl_seconds = NOTION_DEFAULT_SCHEMA_CACHE_TTL_SECONDS;
+        Value ttl_value;
+        if (context.TryGetCurrentSetting("notion_schema_cache_ttl", ttl_value) && !ttl_value.IsNull())
+        {
+            ttl_seconds = ttl_value.GetValue<int64_t>();
+        }
+        auto now = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (listed && now - listed_at < std::chrono::seconds(ttl_seconds))
+            {
+                return;
+            }
+        }
+
+        NotionApiContext api(context, catalog.Cast<NotionCatalog>().GetToken(context));
+        auto schema_cache = NotionSchemaCache::Get(context);
+        case_insensitive_map_t<std::string> names;
+        for (auto &database : list_databases(context, api))
+        {
+            auto database_id = extract_database_id(database.value("id", ""));
+            // Untitled databases and later databases sharing a title are only found by their id
+            auto title = get_database_title(database);
+            auto name = title.empty() || names.find(title) != names.end() ? database_id : title;
+            names[name] = database_id;
+            schema_cache->StoreDatabase(api.token, database_id, make_shared_ptr<const json>(std::move(database)));
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        database_ids = std::move(names);
+        listed_at = now;
+        listed = true;
+    }
+
+    NotionTableEntry &NotionSchemaEntry::GetTable(ClientContext &context, const std::string &name,
+                                                  const std::string &database_id)
+    {
+        // The entry is bound again once the schema of the database changed, or the token of the catalog did
+        auto &notion_catalog = catalog.Cast<NotionCatalog>();
+        NotionApiContext api(context, notion_catalog.GetToken(context));
+        auto database = NotionSchemaCache::Get(context)->GetDatabase(context, api, database_id);
+        auto last_edited_time = database->value("last_edited_time", "");
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto entry = tables.find(name);
+            if (entry != tables.end() && entry->second->database_id == database_id &&
+                entry->second->last_edited_time == last_edited_time && entry->second->bind_data->token == api.token)
+            {
+                return *entry->second;
+            }
+        }
+
+        vector<LogicalType> return_types;
+        vector<string> names;
+        auto bind_data = notion_bind_database(context, database_id, notion_catalog.ScanOptions(), return_types, names);
+        CreateTableInfo info(*this, name);
+        for (idx_t i = 0; i < names.size(); i++)
+        {
+            info.columns.AddColumn(ColumnDefinition(names[i], return_types[i]));
+        }
+        auto table = make_uniq<NotionTableEntry>(catalog, *this, info, std::move(bind_data), last_edited_time);
+
+        std::lock_guard<std::mutex> guard(lock);
+        auto &entry = tables[name];
+        if (entry && entry->database_id == database_id && entry->last_edited_time == last_edited_time &&
+            entry->bind_data->token == api.token)
+        {
+            // Another thread bound the same schema meanwhile
+            return *entry;
+        }
+        if (entry)
+        {
+            replaced_tables[name] = std::move(entry);
+        }
+        entry = std::move(table);
+        return *entry;
+    }
+
+    void NotionSchemaEntry::Scan(ClientContext &context, CatalogType type,
+                                 const std::function<void(CatalogEntry &)> &callback)
+    {
+        if (type != CatalogType::TABLE_ENTRY)
+        {
+            return;
+        }
+        RefreshTableNames(context);
+        case_insensitive_map_t<std::string> names;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            names = database_ids;
+        }
+        for (auto &name : names)
+        {
+            callback(GetTable(context, name.first, name.second));
+        }
+    }
+
+    void NotionSchemaEntry::Scan(CatalogType type, const std::function<void(CatalogEntry &)> &callback)
+    {
+        // Without a context nothing can be fetched, so only the tables created so far are known
+        if (type != CatalogType::TABLE_ENTRY)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        for (auto &table : tables)
+        {
+            callback(*table.second);
+        }
+    }
+
+    optional_ptr<CatalogEntry> NotionSchemaEntry::GetEntry(CatalogTransaction transaction, CatalogType type,
+                                                           const string &name)
+    {
+        if (type != CatalogType::TABLE_ENTRY || !transaction.context)
+        {
+            return nullptr;
+        }
+        auto &context = transaction.GetContext();
+        RefreshTableNames(context);
+        std::string database_id;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto entry = database_ids.find(name);
+            if (entry != database_ids.end())
+            {
+                database_id = entry->second;
+            }
+        }
+        if (database_id.empty())
+        {
+            // Every database is also found by its id, e.g. one created since the workspace was listed
+            try
+            {
+                database_id = extract_database_id(name);
+            }
+            catch (InvalidInputException &)
+            {
+                return nullptr;
+            }
+        }
+        return GetTable(context, name, database_id);
+    }
+
+    static InvalidInputException notion_read_only_error()
+    {
+        return InvalidInputException("Attached Notion workspaces are read only, use COPY ... (FORMAT notion) to write pages");
+    }
+
+    optional_ptr<CatalogEntry> NotionSchemaEntry::CreateIndex(CatalogTransaction transaction, CreateIndexInfo &info,
+                                                              TableCatalogEntry &table)
+    {
+        throw notion_read_only_error();
+    }
+
+    optional_ptr<CatalogEntry> NotionSchemaEntry::CreateFunction(CatalogTransaction transaction, CreateFunctionInfo &info)
+    {
+        throw notion_read_only_error();
+    }
+
+    optional_ptr<CatalogEntry> NotionSchemaEntry::CreateTable(CatalogTransaction transaction, BoundCreateTableInfo &info)
+    {
+        throw notion_read_only_error();
+    }
+
+    optional_ptr<CatalogEntry> NotionSchemaEntry::CreateView(CatalogTransaction transaction, CreateViewInfo &info)
+    {
+        throw notion_read_only_error();
+    }
+
+    optional_ptr<CatalogEntry> NotionSchemaEntry::CreateSequence(CatalogTransaction transaction, CreateSequenceInfo &info)
+    {
+        throw notion_read_only_error();
+    }
+
+    optional_ptr<CatalogEntry> NotionSchemaEntry::CreateTableFunction(CatalogTransaction transaction,
+                                                                      CreateTableFunctionInfo &info)
+    {
+        throw notion_read_only_error();
+    }
+
+    optional_ptr<CatalogEntry> NotionSchemaEntry::CreateCopyFunction(CatalogTransaction transaction,
+                                                                     CreateCopyFunctionInfo &info)
+    {
+        throw notion_read_only_error();
+    }
+
+    optional_ptr<CatalogEntry> NotionSchemaEntry::CreatePragmaFunction(CatalogTransaction transaction,
+                                                                       CreatePragmaFunctionInfo &info)
+    {
+        throw notion_read_only_error();
+    }
+
+    optional_ptr<CatalogEntry> NotionSchemaEntry::CreateCollation(CatalogTransaction transaction, CreateCollationInfo &info)
+    {
+        throw notion_read_only_error();
+    }
+
+    optional_ptr<CatalogEntry> NotionSchemaEntry::CreateType(CatalogTransaction transaction, CreateTypeInfo &info)
+    {
+        throw notion_read_only_error();
+    }
+
+    void NotionSchemaEntry::DropEntry(ClientContext &context, DropInfo &info)
+    {
+        throw notion_read_only_error();
+    }
+
+    void NotionSchemaEntry::Alter(CatalogTransaction transaction, AlterInfo &info)
+    {
+        throw notion_read_only_error();
+    }
+
+    NotionCatalog::NotionCatalog(AttachedDatabase &db, std::string secret_name_p)
+        : Catalog(db), secret_name(std::move(secret_name_p))
+    {
+    }
+
+    std::string NotionCatalog::GetToken(ClientContext &context)
+    {
+        return get_notion_token(context, secret_name);
+    }
+
+    named_parameter_map_t NotionCatalog::ScanOptions() const
+    {
+        named_parameter_map_t options;
+        if (!secret_name.empty())
+        {
+            options["secret"] = Value(secret_name);
+        }
+        return options;
+    }
+
+    void NotionCatalog::Initialize(bool load_builtin)
+    {
+        CreateSchemaInfo info;
+        info.schema = DEFAULT_SCHEMA;
+        main_schema = make_uniq<NotionSchemaEntry>(*this, info);
+    }
+
+    optional_ptr<CatalogEntry> NotionCatalog::CreateSchema(CatalogTransaction transaction, CreateSchemaInfo &info)
+    {
+        throw notion_read_only_error();
+    }
+
+    void NotionCatalog::ScanSchemas(ClientContext &context, std::function<void(SchemaCatalogEntry &)> callback)
+    {
+        callback(*main_schema);
+    }
+
+    optional_ptr<SchemaCatalogEntry> NotionCatalog::GetSchema(CatalogTransaction transaction, const string &schema_name,
+                                                              OnEntryNotFound if_not_found, QueryErrorContext error_context)
+    {
+        if (schema_name == DEFAULT_SCHEMA || schema_name == INVALID_SCHEMA)
+        {
+            return main_schema.get();
+        }
+        if (if_not_found == OnEntryNotFound::RETURN_NULL)
+        {
+            return nullptr;
+        }
+        throw BinderException("Schema \"%s\" not found, an attached Notion workspace only has the schema \"%s\"",
+                              schema_name, DEFAULT_SCHEMA);
+    }
+
+    unique_ptr<PhysicalOperator> NotionCatalog::PlanCreateTableAs(ClientContext &context, LogicalCreateTable &op,
+                                                                  unique_ptr<PhysicalOperator> plan)
+    {
+        throw notion_read_only_error();
+    }
+
+    unique_ptr<PhysicalOperator> NotionCatalog::PlanInsert(ClientContext &context, LogicalInsert &op,
+                                                           unique_ptr<PhysicalOperator> plan)
+    {
+        throw notion_read_only_error();
+    }
+
+    unique_ptr<PhysicalOperator> NotionCatalog::PlanDelete(ClientContext &context, LogicalDelete &op,
+                                                           unique_ptr<PhysicalOperator> plan)
+    {
+        throw notion_read_only_error();
+    }
+
+    unique_ptr<PhysicalOperator> NotionCatalog::PlanUpdate(ClientContext &context, LogicalUpdate &op,
+                                                           unique_ptr<PhysicalOperator> plan)
+    {
+        throw notion_read_only_error();
+    }
+
+    unique_ptr<LogicalOperator> NotionCatalog::BindCreateIndex(Binder &binder, CreateStatement &stmt,
+                                                               TableCatalogEntry &table, unique_ptr<LogicalOperator> plan)
+    {
+        throw notion_read_only_error();
+    }
+
+    DatabaseSize NotionCatalog::GetDatabaseSize(ClientContext &context)
+    {
+        return DatabaseSize();
+    }
+
+    void NotionCatalog::DropSchema(ClientContext &context, DropInfo &info)
+    {
+        throw notion_read_only_error();
+    }
+
+    Transaction &NotionTransactionManager::StartTransaction(ClientContext &context)
+    {
+        auto transaction = make_uniq<NotionTransaction>(*this, context);
+        auto &result = *transaction;
+        std::lock_guard<std::mutex> guard(lock);
+        transactions[&result] = std::move(transaction);
+        return result;
+    }
+
+    ErrorData NotionTransactionManager::CommitTransaction(ClientContext &context, Transaction &transaction)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        transactions.erase(&transaction);
+        return ErrorData();
+    }
+
+    void NotionTransactionManager::RollbackTransaction(Transaction &transaction)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        transactions.erase(&transaction);
+    }
+
+    static unique_ptr<Catalog> notion_attach(StorageExtensionInfo *storage_info, ClientContext &context,
+                                             AttachedDatabase &db, const string &name, AttachInfo &info,
+                                             AccessMode access_mode)
+    {
+        if (!info.path.empty())
+        {
+            throw BinderException("ATTACH (TYPE notion) attaches the workspace of the 'notion' secret, the path must be empty");
+        }
+        std::string secret_name;
+        for (auto &option : info.options)
+        {
+            auto loption = StringUtil::Lower(option.first);
+            if (loption == "secret")
+            {
+                secret_name = option.second.ToString();
+            }
+        }
+        // Fail early when there is no token rather than on the first query
+        get_notion_token(context, secret_name);
+        return make_uniq<NotionCatalog>(db, secret_name);
+    }
+
+    static unique_ptr<TransactionManager> notion_create_transaction_manager(StorageExtensionInfo *storage_info,
+                                                                             AttachedDatabase &db, Catalog &catalog)
+    {
+        return make_uniq<NotionTransactionManager>(db);
+    }
+
+    NotionStorageExtension::NotionStorageExtension()
+    {
+        attach = notion_attach;
+        create_transaction_manager = notion_create_transaction_manager;
+    }
+
+} // namespace duckdb
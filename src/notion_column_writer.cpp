@@ -0,0 +1,544 @@
+#include "notion_column_writer.hpp"
+#include "duckdb/common/types/timestamp.hpp"
+
+namespace duckdb
+{
+
+    // Returns the field of a property value object, or nullptr if it is missing or null
+    static inline const json *find_field(const json &prop_value, const char *key)
+    {
+        auto entry = prop_value.find(key);
+        if (entry == prop_value.end() || entry->is_null())
+        {
+            return nullptr;
+        }
+        return &*entry;
+    }
+
+    static inline void write_string(Vector &result, idx_t row_index, const std::string &str)
+    {
+        FlatVector::GetData<string_t>(result)[row_index] = StringVector::AddString(result, str.data(), str.size());
+    }
+
+    static inline void write_timestamp_string(Vector &result, idx_t row_index, const std::string &str)
+    {
+        timestamp_t timestamp;
+        if (Timestamp::TryConvertTimestamp(str.c_str(), str.size(), timestamp) != TimestampCastResult::SUCCESS)
+        {
+            FlatVector::SetNull(result, row_index, true);
+            return;
+        }
+        FlatVector::GetData<timestamp_t>(result)[row_index] = timestamp;
+    }
+
+    // Rich text is split into runs by formatting, so the plain text of all runs is joined
+    static void write_rich_text(const json &runs, Vector &result, idx_t row_index)
+    {
+        if (runs.size() == 1)
+        {
+            write_string(result, row_index, runs[0]["plain_text"].get_ref<const std::string &>());
+            return;
+        }
+        std::string text;
+        for (const auto &run : runs)
+        {
+            text += run["plain_text"].get_ref<const std::string &>();
+        }
+        write_string(result, row_index, text);
+    }
+
+    static void write_title(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        auto runs = find_field(prop_value, "title");
+        if (!runs)
+        {
+            write_string(result, row_index, "");
+            return;
+        }
+        write_rich_text(*runs, result, row_index);
+    }
+
+    static void write_rich_text_property(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        auto runs = find_field(prop_value, "rich_text");
+        if (!runs)
+        {
+            write_string(result, row_index, "");
+            return;
+        }
+        write_rich_text(*runs, result, row_index);
+    }
+
+    static void write_number(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        auto number = find_field(prop_value, "number");
+        if (!number)
+        {
+            FlatVector::SetNull(result, row_index, true);
+            return;
+        }
+        FlatVector::GetData<double>(result)[row_index] = number->get<double>();
+    }
+
+    static void write_checkbox(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        auto checked = find_field(prop_value, "checkbox");
+        FlatVector::GetData<bool>(result)[row_index] = checked && checked->get<bool>();
+    }
+
+    static void write_date(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        auto date = find_field(prop_value, "date");
+        const json *start = date ? find_field(*date, "start") : nullptr;
+        if (!start)
+        {
+            FlatVector::SetNull(result, row_index, true);
+            return;
+        }
+        write_timestamp_string(result, row_index, start->get_ref<const std::string &>());
+    }
+
+    static void write_created_time(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        auto time = find_field(prop_value, "created_time");
+        if (!time)
+        {
+            FlatVector::SetNull(result, row_index, true);
+            return;
+        }
+        write_timestamp_string(result, row_index, time->get_ref<const std::string &>());
+    }
+
+    static void write_last_edited_time(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        auto time = find_field(prop_value, "last_edited_time");
+        if (!time)
+        {
+            FlatVector::SetNull(result, row_index, true);
+            return;
+        }
+        write_timestamp_string(result, row_index, time->get_ref<const std::string &>());
+    }
+
+    static void write_option_name(const json *option, Vector &result, idx_t row_index)
+    {
+        if (!option)
+        {
+            FlatVector::SetNull(result, row_index, true);
+            return;
+        }
+        write_string(result, row_index, (*option)["name"].get_ref<const std::string &>());
+    }
+
+    static void write_select(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        write_option_name(find_field(prop_value, "select"), result, row_index);
+    }
+
+    static void write_status(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        write_option_name(find_field(prop_value, "status"), result, row_index);
+    }
+
+    template <const char *KEY>
+    static void write_nullable_string(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        auto text = find_field(prop_value, KEY);
+        if (!text)
+        {
+            FlatVector::SetNull(result, row_index, true);
+            return;
+        }
+        write_string(result, row_index, text->get_ref<const std::string &>());
+    }
+
+    static constexpr const char URL_KEY[] = "url";
+    static constexpr const char EMAIL_KEY[] = "email";
+    static constexpr const char PHONE_NUMBER_KEY[] = "phone_number";
+    static constexpr const char PAGE_ID_KEY[] = "id";
+    static constexpr const char CREATED_BY_KEY[] = "created_by";
+    static constexpr const char LAST_EDITED_BY_KEY[] = "last_edited_by";
+
+    // Writes a string into a field of a struct, or NULL if it is missing. Struct fields get their validity set
+    // explicitly, as a row slot may be reused after the whole struct was set to NULL.
+    static void write_string_field(Vector &field, idx_t row_index, const json *value)
+    {
+        if (!value || !value->is_string())
+        {
+            FlatVector::SetNull(field, row_index, true);
+            return;
+        }
+        FlatVector::Validity(field).SetValid(row_index);
+        write_string(field, row_index, value->get_ref<const std::string &>());
+    }
+
+    static void write_timestamp_field(Vector &field, idx_t row_index, const json *value)
+    {
+        if (!value || !value->is_string())
+        {
+            FlatVector::SetNull(field, row_index, true);
+            return;
+        }
+        FlatVector::Validity(field).SetValid(row_index);
+        write_timestamp_string(field, row_index, value->get_ref<const std::string &>());
+    }
+
+    // Writes the entries of a json array as the list of the row. Entries are appended to the child vector,
+    // each written by the entry writer.
+    template <class WRITE_ENTRY>
+    static void write_list(Vector &result, idx_t row_index, const json *entries, WRITE_ENTRY write_entry)
+    {
+        idx_t count = entries && entries->is_array() ? entries->size() : 0;
+        auto offset = ListVector::GetListSize(result);
+        ListVector::Reserve(result, offset + count);
+        auto &child = ListVector::GetEntry(result);
+        for (idx_t i = 0; i < count; i++)
+        {
+            write_entry((*entries)[i], child, offset + i);
+        }
+        ListVector::SetListSize(result, offset + count);
+        FlatVector::GetData<list_entry_t>(result)[row_index] = list_entry_t(offset, count);
+    }
+
+    // Returns the text of a value in a rollup array, which holds property values of the rolled up property
+    static std::string property_value_text(const json &prop_value)
+    {
+        auto type = find_field(prop_value, "type");
+        auto value = type && type->is_string() ? find_field(prop_value, type->get_ref<const std::string &>().c_str()) : nullptr;
+        if (!value)
+        {
+            return "";
+        }
+        if (value->is_string())
+        {
+            return value->get<std::string>();
+        }
+        if (value->is_array())
+        {
+            // Rich text runs, or the options of a multi_select
+            std::string text;
+            for (auto &entry : *value)
+            {
+                if (entry.contains("plain_text"))
+                {
+                    text += entry["plain_text"].get_ref<const std::string &>();
+                }
+                else if (entry.contains("name"))
+                {
+                    text += (text.empty() ? "" : ", ") + entry["name"].get<std::string>();
+                }
+            }
+            return text;
+        }
+        if (value->is_object())
+        {
+            for (auto key : {"name", "start", "id"})
+            {
+                auto field = find_field(*value, key);
+                if (field && field->is_string())
+                {
+                    return field->get<std::string>();
+                }
+            }
+        }
+        return value->dump();
+    }
+
+    static void write_multi_select(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        write_list(result, row_index, find_field(prop_value, "multi_select"), [](const json &option, Vector &child, idx_t index)
+                   { write_string_field(child, index, find_field(option, "name")); });
+    }
+
+    static void write_relation(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        write_list(result, row_index, find_field(prop_value, "relation"), [](const json &page, Vector &child, idx_t index)
+                   { write_string_field(child, index, find_field(page, "id")); });
+    }
+
+    static void write_user(const json &user, Vector &result, idx_t row_index)
+    {
+        auto &fields = StructVector::GetEntries(result);
+        write_string_field(*fields[0], row_index, find_field(user, "id"));
+        write_string_field(*fields[1], row_index, find_field(user, "name"));
+        auto person = find_field(user, "person");
+        write_string_field(*fields[2], row_index, person ? find_field(*person, "email") : nullptr);
+    }
+
+    static void write_people(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        write_list(result, row_index, find_field(prop_value, "people"), write_user);
+    }
+
+    template <const char *KEY>
+    static void write_user_property(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        auto user = find_field(prop_value, KEY);
+        if (!user)
+        {
+            FlatVector::SetNull(result, row_index, true);
+            return;
+        }
+        write_user(*user, result, row_index);
+    }
+
+    static void write_files(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        write_list(result, row_index, find_field(prop_value, "files"), [](const json &file, Vector &child, idx_t index)
+                   {
+                       auto &fields = StructVector::GetEntries(child);
+                       write_string_field(*fields[0], index, find_field(file, "name"));
+                       // Files uploaded to Notion have a temporary url, external files the url they were added with
+                       auto type = find_field(file, "type");
+                       auto location = type && type->is_string() ? find_field(file, type->get_ref<const std::string &>().c_str()) : nullptr;
+                       write_string_field(*fields[1], index, location ? find_field(*location, "url") : nullptr); });
+    }
+
+    static void write_date_range_value(const json *date, Vector &result, idx_t row_index)
+    {
+        if (!date || !find_field(*date, "start"))
+        {
+            FlatVector::SetNull(result, row_index, true);
+            return;
+        }
+        auto &fields = StructVector::GetEntries(result);
+        write_timestamp_field(*fields[0], row_index, find_field(*date, "start"));
+        write_timestamp_field(*fields[1], row_index, find_field(*date, "end"));
+        write_string_field(*fields[2], row_index, find_field(*date, "time_zone"));
+    }
+
+    static void write_date_range(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        write_date_range_value(find_field(prop_value, "date"), result, row_index);
+    }
+
+    static void write_formula(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        auto formula = find_field(prop_value, "formula");
+        if (!formula)
+        {
+            FlatVector::SetNull(result, row_index, true);
+            return;
+        }
+        auto &fields = StructVector::GetEntries(result);
+        write_string_field(*fields[0], row_index, find_field(*formula, "type"));
+        write_string_field(*fields[1], row_index, find_field(*formula, "string"));
+
+        auto number = find_field(*formula, "number");
+        FlatVector::Validity(*fields[2]).Set(row_index, number && number->is_number());
+        if (number && number->is_number())
+        {
+            FlatVector::GetData<double>(*fields[2])[row_index] = number->get<double>();
+        }
+        auto boolean = find_field(*formula, "boolean");
+        FlatVector::Validity(*fields[3]).Set(row_index, boolean && boolean->is_boolean());
+        if (boolean && boolean->is_boolean())
+        {
+            FlatVector::GetData<bool>(*fields[3])[row_index] = boolean->get<bool>();
+        }
+        auto date = find_field(*formula, "date");
+        write_timestamp_field(*fields[4], row_index, date ? find_field(*date, "start") : nullptr);
+    }
+
+    // A rollup is read into the type its aggregation function produces, anything else is NULL
+    static void write_rollup(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        auto rollup = find_field(prop_value, "rollup");
+        auto type = rollup ? find_field(*rollup, "type") : nullptr;
+        if (!type || !type->is_string())
+        {
+            FlatVector::SetNull(result, row_index, true);
+            return;
+        }
+        auto &type_name = type->get_ref<const std::string &>();
+        auto value = find_field(*rollup, type_name.c_str());
+        switch (result.GetType().id())
+        {
+        case LogicalTypeId::DOUBLE:
+            if (type_name == "number" && value && value->is_number())
+            {
+                FlatVector::GetData<double>(result)[row_index] = value->get<double>();
+                return;
+            }
+            break;
+        case LogicalTypeId::TIMESTAMP:
+            if (type_name == "date" && value && find_field(*value, "start"))
+            {
+                write_timestamp_string(result, row_index, (*value)["start"].get_ref<const std::string &>());
+                return;
+            }
+            break;
+        case LogicalTypeId::STRUCT:
+            if (type_name == "date")
+            {
+                write_date_range_value(value, result, row_index);
+                return;
+            }
+            break;
+        case LogicalTypeId::LIST:
+            if (type_name == "array")
+            {
+                write_list(result, row_index, value, [](const json &item, Vector &child, idx_t index)
+                           { write_string(child, index, property_value_text(item)); });
+                return;
+            }
+            break;
+        default:
+            break;
+        }
+        FlatVector::SetNull(result, row_index, true);
+    }
+    static void write_null(const json &prop_value, Vector &result, idx_t row_index)
+    {
+        // Default to NULL for unsupported types
+        FlatVector::SetNull(result, row_index, true);
+    }
+
+    static LogicalType notion_user_type()
+    {
+        return LogicalType::STRUCT({{"id", LogicalType::VARCHAR}, {"name", LogicalType::VARCHAR}, {"email", LogicalType::VARCHAR}});
+    }
+
+    LogicalType notion_date_range_type()
+    {
+        return LogicalType::STRUCT({{"start", LogicalType::TIMESTAMP}, {"end", LogicalType::TIMESTAMP}, {"time_zone", LogicalType::VARCHAR}});
+    }
+
+    // https://developers.notion.com/reference/property-object
+    LogicalType notion_type_to_duckdb_type(const json &property)
+    {
+        std::string notion_type = property["type"];
+        if (notion_type == "title" || notion_type == "rich_text" ||
+            notion_type == "url" || notion_type == "email" ||
+            notion_type == "phone_number" || notion_type == "select" ||
+            notion_type == "status")
+        {
+            return LogicalType::VARCHAR;
+        }
+        else if (notion_type == "number")
+        {
+            return LogicalType::DOUBLE;
+        }
+        else if (notion_type == "checkbox")
+        {
+            return LogicalType::BOOLEAN;
+        }
+        else if (notion_type == "date" || notion_type == "created_time" ||
+                 notion_type == "last_edited_time")
+        {
+            return LogicalType::TIMESTAMP;
+        }
+        else if (notion_type == "multi_select" || notion_type == "relation")
+        {
+            // The option names and the ids of the related pages
+            return LogicalType::LIST(LogicalType::VARCHAR);
+        }
+        else if (notion_type == "people")
+        {
+            return LogicalType::LIST(notion_user_type());
+        }
+        else if (notion_type == "created_by" || notion_type == "last_edited_by")
+        {
+            return notion_user_type();
+        }
+        else if (notion_type == "files")
+        {
+            return LogicalType::LIST(LogicalType::STRUCT({{"name", LogicalType::VARCHAR}, {"url", LogicalType::VARCHAR}}));
+        }
+        else if (notion_type == "formula")
+        {
+            // The schema doesn't say what a formula produces, so every result type gets a field
+            // and "type" names the one that is set
+            return LogicalType::STRUCT({{"type", LogicalType::VARCHAR},
+                                        {"string", LogicalType::VARCHAR},
+                                        {"number", LogicalType::DOUBLE},
+                                        {"boolean", LogicalType::BOOLEAN},
+                                        {"date", LogicalType::TIMESTAMP}});
+        }
+        else if (notion_type == "rollup")
+        {
+            // The result type follows from the aggregation function
+            std::string function;
+            if (property.contains("rollup") && property["rollup"].contains("function"))
+            {
+                function = property["rollup"]["function"].get<std::string>();
+            }
+            if (function == "show_original" || function == "show_unique")
+            {
+                return LogicalType::LIST(LogicalType::VARCHAR);
+            }
+            if (function == "earliest_date" || function == "latest_date")
+            {
+                return LogicalType::TIMESTAMP;
+            }
+            if (function == "date_range")
+            {
+                return notion_date_range_type();
+            }
+            return LogicalType::DOUBLE;
+        }
+
+        // Default to VARCHAR for unknown types
+        return LogicalType::VARCHAR;
+    }
+
+    notion_column_writer_t get_notion_column_writer(NotionPropertyType type)
+    {
+        switch (type)
+        {
+        case NotionPropertyType::TITLE:
+            return write_title;
+        case NotionPropertyType::RICH_TEXT:
+            return write_rich_text_property;
+        case NotionPropertyType::NUMBER:
+            return write_number;
+        case NotionPropertyType::CHECKBOX:
+            return write_checkbox;
+        case NotionPropertyType::DATE:
+            return write_date;
+        case NotionPropertyType::CREATED_TIME:
+            return write_created_time;
+        case NotionPropertyType::LAST_EDITED_TIME:
+            return write_last_edited_time;
+        case NotionPropertyType::SELECT:
+            return write_select;
+        case NotionPropertyType::STATUS:
+            return write_status;
+        case NotionPropertyType::MULTI_SELECT:
+            return write_multi_select;
+        case NotionPropertyType::RELATION:
+            return write_relation;
+        case NotionPropertyType::PEOPLE:
+            return write_people;
+        case NotionPropertyType::CREATED_BY:
+            return write_user_property<CREATED_BY_KEY>;
+        case NotionPropertyType::LAST_EDITED_BY:
+            return write_user_property<LAST_EDITED_BY_KEY>;
+        case NotionPropertyType::FILES:
+            return write_files;
+        case NotionPropertyType::FORMULA:
+            return write_formula;
+        case NotionPropertyType::ROLLUP:
+            return write_rollup;
+        case NotionPropertyType::URL:
+            return write_nullable_string<URL_KEY>;
+        case NotionPropertyType::EMAIL:
+            return write_nullable_string<EMAIL_KEY>;
+        case NotionPropertyType::PHONE_NUMBER:
+            return write_nullable_string<PHONE_NUMBER_KEY>;
+        default:
+            return write_null;
+        }
+    }
+
+    notion_column_writer_t get_notion_date_range_writer()
+    {
+        return write_date_range;
+    }
+
+    notion_column_writer_t get_notion_page_id_writer()
+    {
+        return write_nullable_string<PAGE_ID_KEY>;
+    }
+
+} // namespace duckdb
@@ -0,0 +1,497 @@
+#include "notion_connection_pool.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/string_util.hpp"
+#include <openssl/err.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <sys/socket.h>
+#include <sys/time.h>
+#endif
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+
+namespace duckdb
+{
+
+    // Reads an HTTP/1.1 response from a connection. Everything beyond the current response stays
+    // unread on the connection, so a response has to be consumed exactly for the connection to be
+    // reused.
+    class NotionResponseReader
+    {
+    public:
+        explicit NotionResponseReader(BIO *bio) : bio(bio) {}
+
+        // Reads a line terminated by CRLF and returns it without the terminator
+        std::string ReadLine()
+        {
+            while (true)
+            {
+                auto line_end = buffer.find("\r\n", position);
+                if (line_end != std::string::npos)
+                {
+                    auto line = buffer.substr(position, line_end - position);
+                    position = line_end + 2;
+                    return line;
+                }
+                if (!Fill())
+                {
+                    throw IOException("Connection closed or timed out while reading the Notion API response");
+                }
+            }
+        }
+
+        // Appends exactly count bytes to target. Bytes that are not yet buffered are read straight
+        // into target to avoid copying large bodies twice.
+        void ReadExact(idx_t count, std::string &target)
+        {
+            idx_t buffered = std::min<idx_t>(buffer.size() - position, count);
+            target.append(buffer, position, buffered);
+            position += buffered;
+            count -= buffered;
+
+            while (count > 0)
+            {
+                auto offset = target.size();
+                target.resize(offset + count);
+                int len = BIO_read(bio, &target[offset], static_cast<int>(std::min<idx_t>(count, INT_MAX)));
+                if (len <= 0)
+                {
+                    target.resize(offset);
+                    throw IOException("Connection closed or timed out while reading the Notion API response body");
+                }
+                target.resize(offset + len);
+                count -= len;
+                MarkReceived();
+            }
+        }
+
+        // Appends everything until the server closes the connection to target
+        void ReadToEnd(std::string &target)
+        {
+            target.append(buffer, position, std::string::npos);
+            position = buffer.size();
+            while (Fill())
+            {
+                target.append(buffer, position, std::string::npos);
+                position = buffer.size();
+            }
+        }
+
+        bool ReceivedAny() const
+        {
+            return received_any;
+        }
+
+        //! When the first byte of the response arrived, only meaningful once ReceivedAny() is true
+        std::chrono::steady_clock::time_point FirstByteTime() const
+        {
+            return first_byte_time;
+        }
+
+    private:
+        bool Fill()
+        {
+            // Drop consumed bytes before reading more
+            if (position > 0)
+            {
+                buffer.erase(0, position);
+                position = 0;
+            }
+
+            // Read straight into the buffer instead of copying from a chunk on the stack
+            auto offset = buffer.size();
+            buffer.resize(offset + READ_SIZE);
+            int len = BIO_read(bio, &buffer[offset], READ_SIZE);
+            buffer.resize(offset + MaxValue<int>(len, 0));
+            if (len <= 0)
+            {
+                return false;
+            }
+            MarkReceived();
+            return true;
+        }
+
+        void MarkReceived()
+        {
+            if (!received_any)
+            {
+                first_byte_time = std::chrono::steady_clock::now();
+                received_any = true;
+            }
+        }
+
+    private:
+        static constexpr int READ_SIZE = 16384;
+
+        BIO *bio;
+        std::string buffer;
+        idx_t position = 0;
+        bool received_any = false;
+        std::chrono::steady_clock::time_point first_byte_time;
+    };
+
+    static void send_request(NotionHttpConnection &connection, const std::string &request)
+    {
+        idx_t written = 0;
+        while (written < request.size())
+        {
+            int len = BIO_write(connection.bio, request.data() + written,
+                                static_cast<int>(std::min<idx_t>(request.size() - written, INT_MAX)));
+            if (len <= 0)
+            {
+                throw IOException("Failed to write request");
+            }
+            written += len;
+        }
+    }
+
+    // Bounds how long a read or write of the connection blocks. The SSL BIO passes the request for the
+    // socket on to the connect BIO below it.
+    static void set_socket_timeouts(BIO *bio)
+    {
+        int fd = -1;
+        if (BIO_get_fd(bio, &fd) <= 0 || fd < 0)
+        {
+            return;
+        }
+#ifdef _WIN32
+        DWORD timeout = static_cast<DWORD>(NOTION_POOL_SOCKET_TIMEOUT_SECONDS * 1000);
+#else
+        timeval timeout {};
+        timeout.tv_sec = NOTION_POOL_SOCKET_TIMEOUT_SECONDS;
+#endif
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char *>(&timeout), sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char *>(&timeout), sizeof(timeout));
+    }
+
+    static std::string trim(const std::string &str)
+    {
+        auto begin = str.find_first_not_of(" \t");
+        if (begin == std::string::npos)
+        {
+            return "";
+        }
+        auto end = str.find_last_not_of(" \t");
+        return str.substr(begin, end - begin + 1);
+    }
+
+    static void read_chunked_body(NotionResponseReader &reader, std::string &body)
+    {
+        while (true)
+        {
+            // Chunk extensions after ';' are ignored
+            auto size_line = reader.ReadLine();
+            auto chunk_size = std::strtoull(size_line.c_str(), nullptr, 16);
+            if (chunk_size == 0)
+            {
+                // Skip optional trailers up to the terminating empty line
+                while (!reader.ReadLine().empty())
+                {
+                }
+                return;
+            }
+            reader.ReadExact(chunk_size, body);
+            reader.ReadLine();
+        }
+    }
+
+    // Reads a response, with its body in a buffer taken from the pool
+    static NotionHttpResponse read_response(NotionResponseReader &reader, NotionBufferPool &buffers)
+    {
+        NotionHttpResponse response;
+
+        // Status line, e.g. "HTTP/1.1 200 OK"
+        auto status_line = reader.ReadLine();
+        auto status_start = status_line.find(' ');
+        if (!StringUtil::StartsWith(status_line, "HTTP/") || status_start == std::string::npos)
+        {
+            throw IOException("Invalid status line in Notion API response: " + status_line);
+        }
+        response.status = std::atoi(status_line.c_str() + status_start + 1);
+        response.keep_alive = !StringUtil::StartsWith(status_line, "HTTP/1.0");
+
+        while (true)
+        {
+            auto header_line = reader.ReadLine();
+            if (header_line.empty())
+            {
+                break;
+            }
+            auto separator = header_line.find(':');
+            if (separator == std::string::npos)
+            {
+                continue;
+            }
+            auto name = StringUtil::Lower(header_line.substr(0, separator));
+            response.headers[name] = trim(header_line.substr(separator + 1));
+        }
+
+        auto connection_header = response.headers.find("connection");
+        if (connection_header != response.headers.end())
+        {
+            auto value = StringUtil::Lower(connection_header->second);
+            if (value.find("close") != std::string::npos)
+            {
+                response.keep_alive = false;
+            }
+            else if (value.find("keep-alive") != std::string::npos)
+            {
+                response.keep_alive = true;
+            }
+        }
+
+        auto transfer_encoding = response.headers.find("transfer-encoding");
+        auto content_length = response.headers.find("content-length");
+        if (response.status == 204 || response.status == 304)
+        {
+            return response;
+        }
+        if (transfer_encoding != response.headers.end() &&
+            StringUtil::Lower(transfer_encoding->second).find("chunked") != std::string::npos)
+        {
+            response.body = buffers.Acquire(NOTION_DEFAULT_RESPONSE_CAPACITY);
+            read_chunked_body(reader, response.body);
+        }
+        else if (content_length != response.headers.end())
+        {
+            auto length = std::strtoull(content_length->second.c_str(), nullptr, 10);
+            response.body = buffers.Acquire(length);
+            reader.ReadExact(length, response.body);
+        }
+        else
+        {
+            // Without a length the body is delimited by the server closing the connection
+            response.body = buffers.Acquire(NOTION_DEFAULT_RESPONSE_CAPACITY);
+            reader.ReadToEnd(response.body);
+            response.keep_alive = false;
+        }
+        return response;
+    }
+
+    NotionHttpConnection::~NotionHttpConnection()
+    {
+        BIO_free_all(bio);
+    }
+
+    NotionConnectionPool::NotionConnectionPool(std::string host_p, int port_p, bool use_tls_p, bool verify_tls_p)
+        : host(std::move(host_p)), port(port_p), use_tls(use_tls_p), verify_tls(verify_tls_p)
+    {
+        if (!use_tls)
+        {
+            return;
+        }
+        ctx = SSL_CTX_new(TLS_client_method());
+        if (!ctx)
+        {
+            throw IOException("Failed to create SSL context");
+        }
+        if (verify_tls)
+        {
+            SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, nullptr);
+            if (SSL_CTX_set_default_verify_paths(ctx) != 1)
+            {
+                SSL_CTX_free(ctx);
+                throw IOException("Failed to load the system CA certificates to verify the Notion API with");
+            }
+        }
+
+        // Keep the sessions handed out by the server ourselves so new connections can resume them
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(ctx, StoreSession);
+        SSL_CTX_set_app_data(ctx, this);
+    }
+
+    NotionConnectionPool::~NotionConnectionPool()
+    {
+        idle_connections.clear();
+        if (session)
+        {
+            SSL_SESSION_free(session);
+        }
+        if (ctx)
+        {
+            SSL_CTX_free(ctx);
+        }
+    }
+
+    shared_ptr<NotionConnectionPool> NotionConnectionPool::Get(ClientContext &context, const std::string &host, int port,
+                                                               bool use_tls, bool verify_tls)
+    {
+        auto &cache = ObjectCache::GetObjectCache(context);
+        auto key = ObjectType() + ":" + host + ":" + std::to_string(port) + (use_tls ? ":tls" : ":tcp") +
+                   (verify_tls ? ":verify" : "");
+        return cache.GetOrCreate<NotionConnectionPool>(key, host, port, use_tls, verify_tls);
+    }
+
+    int NotionConnectionPool::StoreSession(SSL *ssl, SSL_SESSION *new_session)
+    {
+        auto pool = static_cast<NotionConnectionPool *>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+        std::lock_guard<std::mutex> guard(pool->lock);
+        if (pool->session)
+        {
+            SSL_SESSION_free(pool->session);
+        }
+        pool->session = new_session;
+        // We took ownership of the session
+        return 1;
+    }
+
+    unique_ptr<NotionHttpConnection> NotionConnectionPool::Connect()
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto connection = Open();
+        connection->handshake_us =
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        return connection;
+    }
+
+    unique_ptr<NotionHttpConnection> NotionConnectionPool::Open()
+    {
+        std::string host_with_port = host + ":" + std::to_string(port);
+        if (!use_tls)
+        {
+            BIO *bio = BIO_new_connect(host_with_port.c_str());
+            if (!bio)
+            {
+                throw IOException("Failed to create BIO");
+            }
+            if (BIO_do_connect(bio) <= 0)
+            {
+                BIO_free_all(bio);
+                throw IOException("Failed to connect to " + host_with_port + ": " +
+                                  std::string(ERR_error_string(ERR_get_error(), nullptr)));
+            }
+            set_socket_timeouts(bio);
+            return make_uniq<NotionHttpConnection>(bio);
+        }
+
+        BIO *bio = BIO_new_ssl_connect(ctx);
+        if (!bio)
+        {
+            throw IOException("Failed to create BIO");
+        }
+
+        SSL *ssl;
+        BIO_get_ssl(bio, &ssl);
+        SSL_set_mode(ssl, SSL_MODE_AUTO_RETRY);
+
+        BIO_set_conn_hostname(bio, host_with_port.c_str());
+        SSL_set_tlsext_host_name(ssl, host.c_str());
+        if (verify_tls)
+        {
+            SSL_set1_host(ssl, host.c_str());
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (session)
+            {
+                SSL_set_session(ssl, session);
+            }
+        }
+
+        // Connect the socket below the SSL BIO first, so the handshake is already bounded by the socket timeouts
+        bool connected = BIO_do_connect(BIO_next(bio)) > 0;
+        if (connected)
+        {
+            set_socket_timeouts(bio);
+            connected = BIO_do_handshake(bio) > 0;
+        }
+        if (!connected)
+        {
+            std::string error = ERR_error_string(ERR_get_error(), nullptr);
+            auto verify_result = SSL_get_verify_result(ssl);
+            if (verify_tls && verify_result != X509_V_OK)
+            {
+                error = std::string("certificate verification failed: ") + X509_verify_cert_error_string(verify_result);
+            }
+            BIO_free_all(bio);
+            throw IOException("Failed to establish SSL connection: " + error);
+        }
+
+        return make_uniq<NotionHttpConnection>(bio);
+    }
+
+    unique_ptr<NotionHttpConnection> NotionConnectionPool::Acquire()
+    {
+        auto now = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            while (!idle_connections.empty())
+            {
+                auto connection = std::move(idle_connections.back());
+                idle_connections.pop_back();
+                if (now - connection->last_used > std::chrono::seconds(NOTION_POOL_IDLE_TIMEOUT_SECONDS))
+                {
+                    // The most recently used connection is stale, so all older ones are as well
+                    idle_connections.clear();
+                    break;
+                }
+                return connection;
+            }
+        }
+        return Connect();
+    }
+
+    void NotionConnectionPool::Release(unique_ptr<NotionHttpConnection> connection)
+    {
+        auto now = std::chrono::steady_clock::now();
+        connection->last_used = now;
+
+        std::lock_guard<std::mutex> guard(lock);
+        auto stale_end = std::find_if(idle_connections.begin(), idle_connections.end(),
+                                      [&](const unique_ptr<NotionHttpConnection> &idle)
+                                      { return now - idle->last_used <= std::chrono::seconds(NOTION_POOL_IDLE_TIMEOUT_SECONDS); });
+        idle_connections.erase(idle_connections.begin(), stale_end);
+        if (idle_connections.size() >= NOTION_POOL_MAX_IDLE_CONNECTIONS)
+        {
+            idle_connections.erase(idle_connections.begin());
+        }
+        idle_connections.push_back(std::move(connection));
+    }
+
+    NotionHttpResponse NotionConnectionPool::Perform(const std::string &request, bool idempotent, NotionBufferPool &buffers)
+    {
+        for (idx_t attempt = 0;; attempt++)
+        {
+            auto connection = Acquire();
+            bool reused = connection->requests > 0;
+
+            NotionResponseReader reader(connection->bio);
+            NotionHttpResponse response;
+            auto sent = std::chrono::steady_clock::now();
+            bool written = false;
+            try
+            {
+                send_request(*connection, request);
+                written = true;
+                response = read_response(reader, buffers);
+            }
+            catch (IOException &)
+            {
+                // The server may close an idle keep-alive connection at any time, in which case nothing
+                // comes back. A request that was written in full may still have been processed though,
+                // so it is only sent again if doing so is harmless.
+                if (reused && !reader.ReceivedAny() && attempt == 0 && (!written || idempotent))
+                {
+                    continue;
+                }
+                throw;
+            }
+
+            response.new_connection = !reused;
+            response.handshake_us = reused ? 0 : connection->handshake_us;
+            response.time_to_first_byte_us =
+                std::chrono::duration_cast<std::chrono::microseconds>(reader.FirstByteTime() - sent).count();
+            connection->requests++;
+            if (response.keep_alive)
+            {
+                Release(std::move(connection));
+            }
+            return response;
+        }
+    }
+
+} // namespace duckdb
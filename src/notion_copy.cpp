@@ -1,161 +1,272 @@
-// #include "notion_copy.hpp"
-// #include "notion_requests.hpp"
-// #include "notion_auth.hpp"
-// #include "notion_utils.hpp"
-
-// #include "duckdb/common/serializer/buffered_file_writer.hpp"
-// #include "duckdb/common/file_system.hpp"
-// #include "duckdb/main/secret/secret_manager.hpp"
-// #include <json.hpp>
-
-// using json = nlohmann::json;
-
-// namespace duckdb
-// {
-
-//     NotionCopyFunction::NotionCopyFunction() : CopyFunction("notion")
-//     {
-//         copy_to_bind = NotionWriteBind;
-//         copy_to_initialize_global = NotionWriteInitializeGlobal;
-//         copy_to_initialize_local = NotionWriteInitializeLocal;
-//         copy_to_sink = NotionWriteSink;
-//     }
-
-//     unique_ptr<FunctionData> NotionCopyFunction::NotionWriteBind(ClientContext &context, CopyFunctionBindInput &input, const vector<string> &names, const vector<LogicalType> &sql_types)
-//     {
-//         string file_path = input.info.file_path;
-
-//         return make_uniq<NotionWriteBindData>(file_path, sql_types, names);
-//     }
-
-//     unique_ptr<GlobalFunctionData> NotionCopyFunction::NotionWriteInitializeGlobal(ClientContext &context, FunctionData &bind_data, const string &file_path)
-//     {
-//         auto &secret_manager = SecretManager::Get(context);
-//         auto transaction = CatalogTransaction::GetSystemCatalogTransaction(context);
-//         auto secret_match = secret_manager.LookupSecret(transaction, "notion", "notion");
-
-//         if (!secret_match.HasMatch())
-//         {
-//             throw InvalidInputException("No 'notion' secret found. Please create a secret with 'CREATE SECRET' first.");
-//         }
-
-//         auto &secret = secret_match.GetSecret();
-//         if (secret.GetType() != "notion")
-//         {
-//             throw InvalidInputException("Invalid secret type. Expected 'notion', got '%s'", secret.GetType());
-//         }
-
-//         const auto *kv_secret = dynamic_cast<const KeyValueSecret *>(&secret);
-//         if (!kv_secret)
-//         {
-//             throw InvalidInputException("Invalid secret format for 'notion' secret");
-//         }
-
-//         Value token_value;
-//         if (!kv_secret->TryGetValue("token", token_value))
-//         {
-//             throw InvalidInputException("'token' not found in 'notion' secret");
-//         }
-
-//         std::string token = token_value.ToString();
-//         std::string database_id = extract_database_id(file_path);
-//         std::string sheet_id = extract_sheet_id(file_path);
-//         std::string sheet_name = "Sheet1";
-
-//         sheet_name = get_sheet_name_from_id(spreadsheet_id, sheet_id, token);
-
-//         std::string encoded_sheet_name = url_encode(sheet_name);
-
-//         // If writing, clear out the entire sheet first.
-//         // Do this here in the initialization so that it only happens once
-//         std::string delete_response = delete_sheet_data(spreadsheet_id, token, encoded_sheet_name);
-
-//         // Write out the headers to the file here in the Initialize so they are only written once
-//         // Create object ready to write to Google Sheet
-//         json sheet_data;
-
-//         sheet_data["range"] = sheet_name;
-//         sheet_data["majorDimension"] = "ROWS";
-
-//         vector<string> headers = bind_data.Cast<NotionWriteBindData>().options.name_list;
-
-//         vector<vector<string>> values;
-//         values.push_back(headers);
-//         sheet_data["values"] = values;
-
-//         // Convert the JSON object to a string
-//         std::string request_body = sheet_data.dump();
-
-//         // Make the API call to write data to the Google Sheet
-//         // Today, this is only append.
-//         std::string response = call_sheets_api(spreadsheet_id, token, encoded_sheet_name, HttpMethod::POST, request_body);
-
-//         // Check for errors in the response
-//         json response_json = parse_json(response);
-//         if (response_json.contains("error"))
-//         {
-//             throw duckdb::IOException("Error writing to Google Sheet: " + response_json["error"]["message"].get<std::string>());
-//         }
-
-//         return make_uniq<NotionCopyGlobalState>(context, spreadsheet_id, token, encoded_sheet_name);
-//     }
-
-//     unique_ptr<LocalFunctionData> NotionCopyFunction::NotionWriteInitializeLocal(ExecutionContext &context, FunctionData &bind_data_p)
-//     {
-//         return make_uniq<LocalFunctionData>();
-//     }
-
-//     void NotionCopyFunction::NotionWriteSink(ExecutionContext &context, FunctionData &bind_data_p, GlobalFunctionData &gstate_p, LocalFunctionData &lstate, DataChunk &input)
-//     {
-//         input.Flatten();
-//         auto &gstate = gstate_p.Cast<NotionCopyGlobalState>();
-
-//         std::string sheet_id = extract_sheet_id(bind_data_p.Cast<NotionWriteBindData>().files[0]);
-
-//         std::string sheet_name = "Sheet1";
-
-//         sheet_name = get_sheet_name_from_id(gstate.spreadsheet_id, sheet_id, gstate.token);
-//         std::string encoded_sheet_name = url_encode(sheet_name);
-//         // Create object ready to write to Google Sheet
-//         json sheet_data;
-
-//         sheet_data["range"] = sheet_name;
-//         sheet_data["majorDimension"] = "ROWS";
-
-//         vector<vector<string>> values;
-
-//         for (idx_t r = 0; r < input.size(); r++)
-//         {
-//             vector<string> row;
-//             for (idx_t c = 0; c < input.ColumnCount(); c++)
-//             {
-//                 auto &col = input.data[c];
-//                 Value val = col.GetValue(r);
-//                 if (val.IsNull())
-//                 {
-//                     row.push_back("");
-//                 }
-//                 else
-//                 {
-//                     row.push_back(val.ToString());
-//                 }
-//             }
-//             values.push_back(row);
-//         }
-//         sheet_data["values"] = values;
-
-//         // Convert the JSON object to a string
-//         std::string request_body = sheet_data.dump();
-
-//         // Make the API call to write data to the Google Sheet
-//         // Today, this is only append.
-//         std::string response = call_sheets_api(gstate.spreadsheet_id, gstate.token, encoded_sheet_name, HttpMethod::POST, request_body);
-
-//         // Check for errors in the response
-//         json response_json = parse_json(response);
-//         if (response_json.contains("error"))
-//         {
-//             throw duckdb::IOException("Error writing to Google Sheet: " + response_json["error"]["message"].get<std::string>());
-//         }
-//     }
-// } // namespace duckdb
\ No newline at end of file
+#include "notion_copy.hpp"
+#include "notion_requests.hpp"
+#include "notion_auth.hpp"
+#include "notion_utils.hpp"
+#include "notion_schema_cache.hpp"
+#include "notion_read.hpp"
+
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/string_util.hpp"
+#include <json.hpp>
+
+using json = nlohmann::json;
+
+namespace duckdb
+{
+
+    NotionCopyFunction::NotionCopyFunction() : CopyFunction("notion")
+    {
+        copy_to_bind = NotionWriteBind;
+        copy_to_initialize_global = NotionWriteInitializeGlobal;
+        copy_to_initialize_local = NotionWriteInitializeLocal;
+        copy_to_sink = NotionWriteSink;
+        copy_to_finalize = NotionWriteFinalize;
+    }
+
+    unique_ptr<FunctionData> NotionCopyFunction::NotionWriteBind(ClientContext &context, CopyFunctionBindInput &input, const vector<string> &names, const vector<LogicalType> &sql_types)
+    {
+        auto result = make_uniq<NotionWriteBindData>();
+        std::string upsert_key;
+        std::string secret_name;
+        result->database_id = extract_database_id(input.info.file_path);
+
+        for (auto &option : input.info.options)
+        {
+            auto loption = StringUtil::Lower(option.first);
+            if (option.second.size() != 1)
+            {
+                throw BinderException("COPY (FORMAT notion): option \"%s\" expects a single value", option.first);
+            }
+            if (loption == "concurrency")
+            {
+                auto concurrency = option.second[0].GetValue<int64_t>();
+                if (concurrency < 1)
+                {
+                    throw BinderException("COPY (FORMAT notion): concurrency must be at least 1");
+                }
+                result->concurrency = concurrency;
+            }
+            else if (loption == "ignore_errors")
+            {
+                result->ignore_errors = option.second[0].GetValue<bool>();
+            }
+            else if (loption == "upsert_key")
+            {
+                upsert_key = option.second[0].ToString();
+            }
+            else if (loption == "secret")
+            {
+                secret_name = option.second[0].ToString();
+            }
+            else
+            {
+                throw BinderException("COPY (FORMAT notion): unrecognized option \"%s\"", option.first);
+            }
+        }
+
+        result->token = get_notion_token(context, secret_name);
+        NotionApiContext api(context, result->token);
+        auto database = NotionSchemaCache::Get(context)->GetDatabase(context, api, result->database_id);
+        if (!database->contains("properties"))
+        {
+            throw IOException("Invalid response from Notion API: database %s has no properties", result->database_id);
+        }
+        auto &properties = (*database)["properties"];
+        for (auto &name : names)
+        {
+            auto property = find_notion_property(properties, name);
+            if (!property)
+            {
+                throw BinderException("COPY (FORMAT notion): column \"%s\" does not match any property of the database", name);
+            }
+            auto type = (*property)["type"].get<std::string>();
+            auto encoder = get_notion_property_encoder(parse_notion_property_type(type));
+            if (!encoder)
+            {
+                throw BinderException("COPY (FORMAT notion): property \"%s\" of type %s can't be written", name, type);
+            }
+            result->property_names.push_back((*property)["name"].get<std::string>());
+            result->encoders.push_back(encoder);
+            result->property_ids.push_back((*property)["id"].get<std::string>());
+            result->read_types.push_back(notion_type_to_duckdb_type(*property));
+            result->column_writers.push_back(get_notion_column_writer(parse_notion_property_type(type)));
+        }
+
+        if (!upsert_key.empty())
+        {
+            for (idx_t col = 0; col < names.size(); col++)
+            {
+                if (StringUtil::CIEquals(names[col], upsert_key) || StringUtil::CIEquals(result->property_names[col], upsert_key))
+                {
+                    result->upsert_column = col;
+                    break;
+                }
+            }
+            if (result->upsert_column == DConstants::INVALID_INDEX)
+            {
+                throw BinderException("COPY (FORMAT notion): upsert_key \"%s\" is not one of the copied columns", upsert_key);
+            }
+        }
+        return std::move(result);
+    }
+
+    // Encodes a value the way it reads back from Notion, so that a row compares equal to the page it was written to.
+    // The value is cast to the read type first, e.g. a DATE to the TIMESTAMP read_notion returns for dates.
+    static json encode_for_comparison(const NotionWriteBindData &bind_data, idx_t col, const Value &value)
+    {
+        Value read_value;
+        if (value.type().id() != LogicalTypeId::LIST && value.type() != bind_data.read_types[col] &&
+            value.DefaultTryCastAs(bind_data.read_types[col], read_value, nullptr))
+        {
+            return bind_data.encoders[col](read_value);
+        }
+        return bind_data.encoders[col](value);
+    }
+
+    static hash_t hash_properties(const json &properties)
+    {
+        return std::hash<std::string>()(properties.dump());
+    }
+
+    // Reads the copied properties of every page of the database, indexing the pages by their upsert key.
+    // Only the copied properties are requested, so this costs one request per 100 pages.
+    static void load_upsert_index(ClientContext &context, const NotionWriteBindData &bind_data, NotionCopyGlobalState &gstate)
+    {
+        NotionResponseLayout layout;
+        vector<LogicalType> types = {LogicalType::VARCHAR};
+        layout.page_field_columns["id"] = 0;
+        layout.column_writers = {get_notion_page_id_writer()};
+        for (idx_t col = 0; col < bind_data.property_names.size(); col++)
+        {
+            layout.property_columns[bind_data.property_names[col]] = col + 1;
+            layout.column_writers.push_back(bind_data.column_writers[col]);
+            types.push_back(bind_data.read_types[col]);
+        }
+
+        DataChunk chunk;
+        chunk.Initialize(Allocator::Get(context), types, NOTION_MAX_PAGE_SIZE);
+        auto &key_name = bind_data.property_names[bind_data.upsert_column];
+        std::string next_cursor;
+        do
+        {
+            json request_body = {{"page_size", NOTION_MAX_PAGE_SIZE}};
+            if (!next_cursor.empty())
+            {
+                request_body["start_cursor"] = next_cursor;
+            }
+            auto response = query_database(context, *gstate.api, bind_data.database_id, request_body.dump(),
+                                           bind_data.property_ids);
+            chunk.Reset();
+            auto page = notion_parse_query_response(response, layout, chunk, 0, NOTION_MAX_PAGE_SIZE);
+            for (idx_t row = 0; row < page.row_count; row++)
+            {
+                if (chunk.GetValue(bind_data.upsert_column + 1, row).IsNull())
+                {
+                    continue;
+                }
+                json properties = json::object();
+                for (idx_t col = 0; col < bind_data.property_names.size(); col++)
+                {
+                    properties[bind_data.property_names[col]] = bind_data.encoders[col](chunk.GetValue(col + 1, row));
+                }
+                // Should several pages share a key, the first one is updated
+                gstate.upsert_index.emplace(properties[key_name].dump(),
+                                            NotionUpsertTarget {chunk.GetValue(0, row).ToString(), hash_properties(properties), false});
+            }
+            next_cursor = page.has_more ? page.next_cursor : "";
+        } while (!next_cursor.empty());
+    }
+
+    unique_ptr<GlobalFunctionData> NotionCopyFunction::NotionWriteInitializeGlobal(ClientContext &context, FunctionData &bind_data_p, const string &file_path)
+    {
+        auto &bind_data = bind_data_p.Cast<NotionWriteBindData>();
+        auto result = make_uniq<NotionCopyGlobalState>(context, bind_data.token, bind_data.concurrency);
+        if (bind_data.upsert_column != DConstants::INVALID_INDEX)
+        {
+            load_upsert_index(context, bind_data, *result);
+        }
+        return std::move(result);
+    }
+
+    unique_ptr<LocalFunctionData> NotionCopyFunction::NotionWriteInitializeLocal(ExecutionContext &context, FunctionData &bind_data_p)
+    {
+        return make_uniq<LocalFunctionData>();
+    }
+
+    void NotionCopyFunction::NotionWriteSink(ExecutionContext &context, FunctionData &bind_data_p, GlobalFunctionData &gstate_p, LocalFunctionData &lstate, DataChunk &input)
+    {
+        auto &bind_data = bind_data_p.Cast<NotionWriteBindData>();
+        auto &gstate = gstate_p.Cast<NotionCopyGlobalState>();
+
+        // Every row becomes one create page request, or with upsert_key an update of the page with the same key
+        // unless none of its properties changed
+        bool upsert = bind_data.upsert_column != DConstants::INVALID_INDEX;
+        json parent = {{"database_id", bind_data.database_id}};
+        for (idx_t row = 0; row < input.size(); row++)
+        {
+            auto row_number = gstate.rows++;
+            json properties = json::object();
+            json compared = json::object();
+            for (idx_t col = 0; col < input.ColumnCount(); col++)
+            {
+                auto value = input.GetValue(col, row);
+                properties[bind_data.property_names[col]] = bind_data.encoders[col](value);
+                if (upsert)
+                {
+                    compared[bind_data.property_names[col]] = encode_for_comparison(bind_data, col, value);
+                }
+            }
+
+            if (upsert && !input.GetValue(bind_data.upsert_column, row).IsNull())
+            {
+                auto key = compared[bind_data.property_names[bind_data.upsert_column]].dump();
+                auto &target = gstate.upsert_index[key];
+                if (target.copied)
+                {
+                    gstate.dispatcher.Fail(row_number, StringUtil::Format("upsert_key %s appears in more than one row of the COPY",
+                                                                          input.GetValue(bind_data.upsert_column, row).ToString()));
+                    continue;
+                }
+                target.copied = true;
+                if (!target.page_id.empty())
+                {
+                    if (target.properties_hash == hash_properties(compared))
+                    {
+                        continue;
+                    }
+                    json body = {{"properties", std::move(properties)}};
+                    gstate.dispatcher.Submit({row_number, HttpMethod::PATCH, "/v1/pages/" + target.page_id, body.dump()});
+                    continue;
+                }
+            }
+            json body = {{"parent", parent}, {"properties", std::move(properties)}};
+            gstate.dispatcher.Submit({row_number, HttpMethod::POST, "/v1/pages", body.dump()});
+        }
+    }
+
+    void NotionCopyFunction::NotionWriteFinalize(ClientContext &context, FunctionData &bind_data_p, GlobalFunctionData &gstate_p)
+    {
+        auto &bind_data = bind_data_p.Cast<NotionWriteBindData>();
+        auto &gstate = gstate_p.Cast<NotionCopyGlobalState>();
+
+        auto errors = gstate.dispatcher.Finish();
+        if (errors.empty() || bind_data.ignore_errors)
+        {
+            return;
+        }
+
+        // Rows are numbered from 1 in the order they were copied
+        std::string message = StringUtil::Format("COPY (FORMAT notion): %d of %d rows could not be written, %d pages were written",
+                                                 errors.size(), gstate.rows.load(), gstate.dispatcher.Succeeded());
+        for (idx_t i = 0; i < errors.size() && i < NOTION_COPY_MAX_REPORTED_ERRORS; i++)
+        {
+            message += StringUtil::Format("\nrow %d: %s", errors[i].row + 1, errors[i].message);
+        }
+        if (errors.size() > NOTION_COPY_MAX_REPORTED_ERRORS)
+        {
+            message += StringUtil::Format("\n... and %d more", errors.size() - NOTION_COPY_MAX_REPORTED_ERRORS);
+        }
+        throw IOException(message);
+    }
+
+} // namespace duckdb
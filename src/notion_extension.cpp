@@ -21,7 +21,16 @@
 #include "notion_extension.hpp"
 #include "notion_auth.hpp"
 #include "notion_read.hpp"
-// #include "notion_copy.hpp"
+#include "notion_optimizer.hpp"
+#include "notion_rate_limiter.hpp"
+#include "notion_requests.hpp"
+#include "notion_schema_cache.hpp"
+#include "notion_sync.hpp"
+#include "notion_related.hpp"
+#include "notion_blocks.hpp"
+#include "notion_copy.hpp"
+#include "notion_catalog.hpp"
+#include "notion_metrics.hpp"
 
 namespace duckdb
 {
@@ -34,19 +43,97 @@ namespace duckdb
         OpenSSL_add_all_algorithms();
 
         // Register read_notion table function
-        auto read_notion_function = TableFunction("read_notion", {LogicalType::VARCHAR}, notion_read_function, notion_bind_function);
-        ExtensionUtil::RegisterFunction(instance, read_notion_function);
-
-        // // Register COPY TO (FORMAT 'gsheet') function
-        // GSheetCopyFunction gsheet_copy_function;
-        // ExtensionUtil::RegisterFunction(instance, gsheet_copy_function);
+        ExtensionUtil::RegisterFunction(instance, notion_read_table_function());
+
+        // Register notion_sync, which incrementally refreshes a local copy of a database
+        ExtensionUtil::RegisterFunction(instance, notion_sync_table_function());
+
+        // Register read_notion_related, which resolves the pages of a relation
+        auto read_notion_related_function = notion_read_related_table_function();
+        ExtensionUtil::RegisterFunction(instance, read_notion_related_function);
+
+        // Register read_notion_blocks, which reads the content of pages
+        ExtensionUtil::RegisterFunction(instance, notion_read_blocks_table_function());
+
+        // Register notion_clear_cache, which drops the cached database schemas
+        ExtensionUtil::RegisterFunction(instance, notion_clear_cache_table_function());
+
+        // Register notion_metrics, which reports the counters of the Notion API traffic
+        ExtensionUtil::RegisterFunction(instance, notion_metrics_table_function());
+
+        auto &config = DBConfig::GetConfig(instance);
+
+        // Rate limiting and retries of Notion API requests
+        config.AddExtensionOption("notion_requests_per_second",
+                                  "Average number of Notion API requests sent per second for each integration token",
+                                  LogicalType::DOUBLE, Value::DOUBLE(NOTION_DEFAULT_REQUESTS_PER_SECOND));
+        config.AddExtensionOption("notion_request_burst",
+                                  "Number of Notion API requests that can be sent back to back after an idle period",
+                                  LogicalType::BIGINT, Value::BIGINT(NOTION_DEFAULT_REQUEST_BURST));
+        config.AddExtensionOption("notion_max_retries",
+                                  "Number of times a Notion API request is retried after a 429 or 5xx response",
+                                  LogicalType::BIGINT, Value::BIGINT(NOTION_DEFAULT_MAX_RETRIES));
+        config.AddExtensionOption("notion_retry_base_delay_ms",
+                                  "Initial backoff in milliseconds before retrying a Notion API request without Retry-After",
+                                  LogicalType::BIGINT, Value::BIGINT(NOTION_DEFAULT_RETRY_BASE_DELAY_MS));
+        config.AddExtensionOption("notion_retry_max_delay_ms",
+                                  "Maximum wait in milliseconds before retrying a Notion API request, also caps the server's Retry-After",
+                                  LogicalType::BIGINT, Value::BIGINT(NOTION_DEFAULT_RETRY_MAX_DELAY_MS));
+
+        // The API endpoint, e.g. a local mock server for tests and benchmarks
+        config.AddExtensionOption("notion_api_host", "Host name of the Notion API", LogicalType::VARCHAR,
+                                  Value(NOTION_DEFAULT_API_HOST));
+        config.AddExtensionOption("notion_api_port", "Port of the Notion API", LogicalType::BIGINT,
+                                  Value::BIGINT(NOTION_DEFAULT_API_PORT));
+        config.AddExtensionOption("notion_api_use_tls", "Whether the Notion API is reached over TLS", LogicalType::BOOLEAN,
+                                  Value::BOOLEAN(NOTION_DEFAULT_API_USE_TLS));
+        config.AddExtensionOption("notion_api_verify_tls",
+                                  "Whether the certificate of the Notion API is verified against the system CA store",
+                                  LogicalType::BOOLEAN, Value::BOOLEAN(NOTION_DEFAULT_API_VERIFY_TLS));
+
+        // Pipelining of read_notion requests
+        config.AddExtensionOption("notion_prefetch_pages",
+                                  "Number of pages read_notion fetches ahead of decoding them for each scanned slice, 0 disables prefetching",
+                                  LogicalType::BIGINT, Value::BIGINT(NOTION_DEFAULT_PREFETCH_PAGES));
+
+        // Caching of database schemas across statements
+        config.AddExtensionOption("notion_schema_cache_ttl",
+                                  "Seconds a cached Notion database schema is used before it is revalidated, 0 disables the cache",
+                                  LogicalType::BIGINT, Value::BIGINT(NOTION_DEFAULT_SCHEMA_CACHE_TTL_SECONDS));
+
+        // Opt-in local cache of fetched pages
+        config.AddExtensionOption("notion_page_cache_directory",
+                                  "Directory of the local cache of Notion pages read_notion is served from, empty disables it",
+                                  LogicalType::VARCHAR, Value(""));
+        config.AddExtensionOption("notion_page_cache_max_age",
+                                  "Seconds a page cache entry is only refreshed with changed pages before it is fetched in full again",
+                                  LogicalType::BIGINT, Value::BIGINT(NOTION_DEFAULT_PAGE_CACHE_MAX_AGE_SECONDS));
+
+        // Page objects looked up by read_notion_related
+        config.AddExtensionOption("notion_related_page_cache_size",
+                                  "Number of pages read_notion_related keeps in memory for later lookups, 0 disables the cache",
+                                  LogicalType::BIGINT, Value::BIGINT(NOTION_DEFAULT_RELATED_PAGE_CACHE_SIZE));
+        config.AddExtensionOption("notion_related_page_cache_ttl",
+                                  "Seconds a page cached by read_notion_related is used before it is fetched again",
+                                  LogicalType::BIGINT, Value::BIGINT(NOTION_DEFAULT_RELATED_PAGE_CACHE_TTL_SECONDS));
+
+        // Push ORDER BY ... LIMIT and LIMIT over read_notion into the Notion query
+        OptimizerExtension notion_optimizer;
+        notion_optimizer.optimize_function = notion_optimize_function;
+        config.optimizer_extensions.push_back(std::move(notion_optimizer));
+
+        // Register COPY TO (FORMAT 'notion') function
+        NotionCopyFunction notion_copy_function;
+        ExtensionUtil::RegisterFunction(instance, notion_copy_function);
+
+        // Register ATTACH '' AS workspace (TYPE notion)
+        config.storage_extensions["notion"] = make_uniq<NotionStorageExtension>();
 
         // Register Secret functions
         CreateNotionSecretFunctions::Register(instance);
 
-        // Register replacement scan for read_gsheet
-        // auto &config = DBConfig::GetConfig(instance);
-        // config.replacement_scans.emplace_back(ReadSheetReplacement);
+        // Register replacement scan for FROM 'https://www.notion.so/...'
+        config.replacement_scans.emplace_back(notion_replacement_scan);
     }
 
     void NotionExtension::Load(DuckDB &db)
@@ -0,0 +1,312 @@
+#include "notion_filter.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/types/timestamp.hpp"
+#include "duckdb/planner/filter/constant_filter.hpp"
+#include "duckdb/planner/filter/conjunction_filter.hpp"
+#include "duckdb/planner/filter/null_filter.hpp"
+#include "duckdb/planner/filter/optional_filter.hpp"
+#include <cmath>
+
+namespace duckdb
+{
+
+    static timestamp_t add_days(timestamp_t timestamp, int64_t days)
+    {
+        return Timestamp::FromEpochMicroSeconds(Timestamp::GetEpochMicroSeconds(timestamp) + days * Interval::MICROS_PER_DAY);
+    }
+
+    static json property_condition(const NotionProperty &property, const char *type_key, const char *condition, json value)
+    {
+        return {{"property", property.name}, {type_key, {{condition, std::move(value)}}}};
+    }
+
+    // Translates a comparison on a date or timestamp column. Notion compares dates at its own granularity
+    // and in its own time zone handling, so bounds are widened by a day and the scan applies the exact
+    // comparison afterwards.
+    static bool translate_date_comparison(const NotionProperty &property, const ConstantFilter &filter, vector<json> &conditions)
+    {
+        auto timestamp = TimestampValue::Get(filter.constant);
+        if (!Timestamp::IsFinite(timestamp))
+        {
+            return false;
+        }
+
+        bool is_timestamp = property.type == NotionPropertyType::CREATED_TIME || property.type == NotionPropertyType::LAST_EDITED_TIME;
+        const char *type_key = property.type == NotionPropertyType::CREATED_TIME       ? "created_time"
+                               : property.type == NotionPropertyType::LAST_EDITED_TIME ? "last_edited_time"
+                                                                                       : "date";
+        auto make_condition = [&](const char *condition, timestamp_t bound)
+        {
+            json result = {{type_key, {{condition, notion_timestamp_to_iso8601(bound)}}}};
+            if (is_timestamp)
+            {
+                result["timestamp"] = type_key;
+            }
+            else
+            {
+                result["property"] = property.name;
+            }
+            return result;
+        };
+
+        switch (filter.comparison_type)
+        {
+        case ExpressionType::COMPARE_EQUAL:
+            conditions.push_back(make_condition("on_or_after", add_days(timestamp, -1)));
+            conditions.push_back(make_condition("on_or_before", add_days(timestamp, 1)));
+            return true;
+        case ExpressionType::COMPARE_LESSTHAN:
+        case ExpressionType::COMPARE_LESSTHANOREQUALTO:
+            conditions.push_back(make_condition("on_or_before", add_days(timestamp, 1)));
+            return true;
+        case ExpressionType::COMPARE_GREATERTHAN:
+        case ExpressionType::COMPARE_GREATERTHANOREQUALTO:
+            conditions.push_back(make_condition("on_or_after", add_days(timestamp, -1)));
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Translates a comparison against a constant into zero or more Notion conditions that must all hold
+    static bool translate_comparison(const NotionProperty &property, const ConstantFilter &filter, vector<json> &conditions)
+    {
+        if (filter.constant.IsNull() || filter.constant.type().IsNested())
+        {
+            // Whole lists and structs (e.g. date ranges) are only compared locally
+            return false;
+        }
+
+        switch (property.type)
+        {
+        case NotionPropertyType::NUMBER:
+        {
+            auto number = filter.constant.GetValue<double>();
+            if (!std::isfinite(number))
+            {
+                return false;
+            }
+            const char *condition;
+            switch (filter.comparison_type)
+            {
+            case ExpressionType::COMPARE_EQUAL:
+                condition = "equals";
+                break;
+            case ExpressionType::COMPARE_NOTEQUAL:
+                condition = "does_not_equal";
+                break;
+            case ExpressionType::COMPARE_LESSTHAN:
+                condition = "less_than";
+                break;
+            case ExpressionType::COMPARE_GREATERTHAN:
+                condition = "greater_than";
+                break;
+            case ExpressionType::COMPARE_LESSTHANOREQUALTO:
+                condition = "less_than_or_equal_to";
+                break;
+            case ExpressionType::COMPARE_GREATERTHANOREQUALTO:
+                condition = "greater_than_or_equal_to";
+                break;
+            default:
+                return false;
+            }
+            conditions.push_back(property_condition(property, "number", condition, number));
+            return true;
+        }
+        case NotionPropertyType::CHECKBOX:
+        {
+            auto checked = BooleanValue::Get(filter.constant);
+            if (filter.comparison_type == ExpressionType::COMPARE_EQUAL)
+            {
+                conditions.push_back(property_condition(property, "checkbox", "equals", checked));
+                return true;
+            }
+            if (filter.comparison_type == ExpressionType::COMPARE_NOTEQUAL)
+            {
+                conditions.push_back(property_condition(property, "checkbox", "does_not_equal", checked));
+                return true;
+            }
+            return false;
+        }
+        case NotionPropertyType::DATE:
+        case NotionPropertyType::CREATED_TIME:
+        case NotionPropertyType::LAST_EDITED_TIME:
+            return translate_date_comparison(property, filter, conditions);
+        case NotionPropertyType::SELECT:
+        case NotionPropertyType::STATUS:
+        case NotionPropertyType::TITLE:
+        case NotionPropertyType::RICH_TEXT:
+        case NotionPropertyType::URL:
+        case NotionPropertyType::EMAIL:
+        case NotionPropertyType::PHONE_NUMBER:
+        {
+            const char *type_key = property.type == NotionPropertyType::SELECT         ? "select"
+                                   : property.type == NotionPropertyType::STATUS       ? "status"
+                                   : property.type == NotionPropertyType::TITLE        ? "title"
+                                   : property.type == NotionPropertyType::RICH_TEXT    ? "rich_text"
+                                   : property.type == NotionPropertyType::URL          ? "url"
+                                   : property.type == NotionPropertyType::EMAIL        ? "email"
+                                                                                       : "phone_number";
+            auto &text = StringValue::Get(filter.constant);
+            if (text.empty())
+            {
+                // Empty titles and texts are read as "", but Notion's equals "" doesn't match them
+                return false;
+            }
+            if (filter.comparison_type == ExpressionType::COMPARE_EQUAL)
+            {
+                conditions.push_back(property_condition(property, type_key, "equals", text));
+                return true;
+            }
+            if (filter.comparison_type == ExpressionType::COMPARE_NOTEQUAL)
+            {
+                conditions.push_back(property_condition(property, type_key, "does_not_equal", text));
+                return true;
+            }
+            return false;
+        }
+        default:
+            return false;
+        }
+    }
+
+    // Translates IS NULL / IS NOT NULL for the property types that are read as NULL when empty
+    static bool translate_null_check(const NotionProperty &property, bool is_null, vector<json> &conditions)
+    {
+        const char *type_key;
+        switch (property.type)
+        {
+        case NotionPropertyType::NUMBER:
+            type_key = "number";
+            break;
+        case NotionPropertyType::DATE:
+            type_key = "date";
+            break;
+        case NotionPropertyType::SELECT:
+            type_key = "select";
+            break;
+        case NotionPropertyType::URL:
+            type_key = "url";
+            break;
+        case NotionPropertyType::EMAIL:
+            type_key = "email";
+            break;
+        case NotionPropertyType::PHONE_NUMBER:
+            type_key = "phone_number";
+            break;
+        default:
+            return false;
+        }
+        conditions.push_back(property_condition(property, type_key, is_null ? "is_empty" : "is_not_empty", true));
+        return true;
+    }
+
+    static bool translate_leaf(const NotionProperty &property, const TableFilter &filter, vector<json> &conditions)
+    {
+        switch (filter.filter_type)
+        {
+        case TableFilterType::CONSTANT_COMPARISON:
+            return translate_comparison(property, filter.Cast<ConstantFilter>(), conditions);
+        case TableFilterType::IS_NULL:
+            return translate_null_check(property, true, conditions);
+        case TableFilterType::IS_NOT_NULL:
+            return translate_null_check(property, false, conditions);
+        default:
+            // Includes filter types of newer DuckDB versions, e.g. the IN_FILTER that replaces the OR of
+            // equalities an IN list is pushed as here. Leaving them out only widens the query.
+            return false;
+        }
+    }
+
+    // Appends the conditions that must all hold for the filter to pass. Parts that can't be translated
+    // are skipped, which only widens the set of pages returned.
+    static void translate_filter(const NotionProperty &property, const TableFilter &filter, vector<json> &conditions)
+    {
+        switch (filter.filter_type)
+        {
+        case TableFilterType::CONJUNCTION_AND:
+            for (auto &child : filter.Cast<ConjunctionAndFilter>().child_filters)
+            {
+                translate_filter(property, *child, conditions);
+            }
+            break;
+        case TableFilterType::CONJUNCTION_OR:
+        {
+            // Notion allows only two levels of nesting, so an OR is pushed only if every branch is a single
+            // condition. Dropping a branch would make the filter narrower, so it is all or nothing.
+            auto &or_filter = filter.Cast<ConjunctionOrFilter>();
+            if (or_filter.child_filters.size() > NOTION_MAX_FILTER_CONDITIONS)
+            {
+                break;
+            }
+            json branches = json::array();
+            for (auto &child : or_filter.child_filters)
+            {
+                vector<json> branch;
+                if (!translate_leaf(property, *child, branch) || branch.size() != 1)
+                {
+                    return;
+                }
+                branches.push_back(std::move(branch[0]));
+            }
+            conditions.push_back({{"or", std::move(branches)}});
+            break;
+        }
+        case TableFilterType::OPTIONAL_FILTER:
+            // Optional filters are pruning hints, the predicate itself stays in the plan. This DuckDB version
+            // pushes an IN list as an optional OR of equalities, which is translated like any other OR.
+            translate_filter(property, *filter.Cast<OptionalFilter>().child_filter, conditions);
+            break;
+        default:
+        {
+            vector<json> leaf_conditions;
+            if (translate_leaf(property, filter, leaf_conditions))
+            {
+                conditions.insert(conditions.end(), leaf_conditions.begin(), leaf_conditions.end());
+            }
+            break;
+        }
+        }
+    }
+
+    json notion_filter_from_table_filters(const TableFilterSet &filters, const vector<column_t> &column_ids,
+                                          const vector<NotionProperty> &properties)
+    {
+        vector<json> conditions;
+        for (auto &entry : filters.filters)
+        {
+            auto column_id = column_ids[entry.first];
+            if (column_id == COLUMN_IDENTIFIER_ROW_ID)
+            {
+                continue;
+            }
+            auto &property = properties[column_id];
+            if (property.page_field && property.type != NotionPropertyType::LAST_EDITED_TIME)
+            {
+                // The page id can't be filtered on in a query
+                continue;
+            }
+            translate_filter(property, *entry.second, conditions);
+        }
+
+        if (conditions.empty())
+        {
+            return json();
+        }
+        if (conditions.size() > NOTION_MAX_FILTER_CONDITIONS)
+        {
+            conditions.resize(NOTION_MAX_FILTER_CONDITIONS);
+        }
+        if (conditions.size() == 1)
+        {
+            return std::move(conditions[0]);
+        }
+        return {{"and", conditions}};
+    }
+
+    json notion_last_edited_since_filter(timestamp_t since)
+    {
+        return {{"timestamp", "last_edited_time"}, {"last_edited_time", {{"on_or_after", notion_timestamp_to_iso8601(since)}}}};
+    }
+
+} // namespace duckdb
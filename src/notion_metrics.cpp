@@ -0,0 +1,134 @@
+#include "notion_metrics.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/string_util.hpp"
+
+namespace duckdb
+{
+
+    //! The counters of the scan running on this thread
+    static thread_local NotionMetrics *current_scan = nullptr;
+
+    vector<std::pair<std::string, uint64_t>> NotionMetrics::Snapshot() const
+    {
+        return {{"requests", requests.load()},
+                {"retries", retries.load()},
+                {"throttled_responses", throttled_responses.load()},
+                {"bytes_received", bytes_received.load()},
+                {"connections_opened", connections_opened.load()},
+                {"handshake_us", handshake_us.load()},
+                {"time_to_first_byte_us", time_to_first_byte_us.load()},
+                {"rate_limit_wait_us", rate_limit_wait_us.load()},
+                {"parse_us", parse_us.load()},
+                {"rows", rows.load()}};
+    }
+
+    shared_ptr<NotionInstanceMetrics> NotionInstanceMetrics::Get(ClientContext &context)
+    {
+        auto &cache = ObjectCache::GetObjectCache(context);
+        return cache.GetOrCreate<NotionInstanceMetrics>(ObjectType());
+    }
+
+    void NotionInstanceMetrics::StoreLastScan(const NotionMetrics &scan)
+    {
+        auto snapshot = scan.Snapshot();
+        std::lock_guard<std::mutex> guard(lock);
+        last_scan = std::move(snapshot);
+    }
+
+    vector<std::pair<std::string, uint64_t>> NotionInstanceMetrics::LastScan()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (last_scan.empty())
+        {
+            return NotionMetrics().Snapshot();
+        }
+        return last_scan;
+    }
+
+    NotionMetricsScope::NotionMetricsScope(NotionMetrics &scan) : previous(current_scan)
+    {
+        current_scan = &scan;
+    }
+
+    NotionMetricsScope::~NotionMetricsScope()
+    {
+        current_scan = previous;
+    }
+
+    void notion_record_metric(NotionInstanceMetrics &instance, notion_metric_t counter, uint64_t value)
+    {
+        instance.metrics.*counter += value;
+        if (current_scan)
+        {
+            current_scan->*counter += value;
+        }
+    }
+
+    uint64_t notion_elapsed_us(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    struct NotionMetricsBindData : public TableFunctionData
+    {
+        bool last_scan = false;
+    };
+
+    struct NotionMetricsGlobalState : public GlobalTableFunctionState
+    {
+        bool finished = false;
+    };
+
+    static unique_ptr<FunctionData> notion_metrics_bind(ClientContext &context, TableFunctionBindInput &input,
+                                                        vector<LogicalType> &return_types, vector<string> &names)
+    {
+        auto bind_data = make_uniq<NotionMetricsBindData>();
+        for (auto &kv : input.named_parameters)
+        {
+            if (StringUtil::Lower(kv.first) == "last_scan")
+            {
+                bind_data->last_scan = BooleanValue::Get(kv.second);
+            }
+        }
+        names.push_back("metric");
+        return_types.push_back(LogicalType::VARCHAR);
+        names.push_back("value");
+        return_types.push_back(LogicalType::UBIGINT);
+        return std::move(bind_data);
+    }
+
+    static unique_ptr<GlobalTableFunctionState> notion_metrics_init_global(ClientContext &context,
+                                                                           TableFunctionInitInput &input)
+    {
+        return make_uniq<NotionMetricsGlobalState>();
+    }
+
+    static void notion_metrics_function(ClientContext &context, TableFunctionInput &data_p, DataChunk &output)
+    {
+        auto &bind_data = data_p.bind_data->Cast<NotionMetricsBindData>();
+        auto &gstate = data_p.global_state->Cast<NotionMetricsGlobalState>();
+        if (gstate.finished)
+        {
+            return;
+        }
+        gstate.finished = true;
+
+        auto instance_metrics = NotionInstanceMetrics::Get(context);
+        auto counters = bind_data.last_scan ? instance_metrics->LastScan() : instance_metrics->metrics.Snapshot();
+        for (idx_t i = 0; i < counters.size(); i++)
+        {
+            output.SetValue(0, i, Value(counters[i].first));
+            output.SetValue(1, i, Value::UBIGINT(counters[i].second));
+        }
+        output.SetCardinality(counters.size());
+    }
+
+    TableFunction notion_metrics_table_function()
+    {
+        TableFunction function("notion_metrics", {}, notion_metrics_function, notion_metrics_bind,
+                               notion_metrics_init_global);
+        function.named_parameters["last_scan"] = LogicalType::BOOLEAN;
+        return function;
+    }
+
+} // namespace duckdb
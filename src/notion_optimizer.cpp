@@ -0,0 +1,169 @@
+#include "notion_optimizer.hpp"
+#include "notion_read.hpp"
+#include "duckdb/planner/expression/bound_columnref_expression.hpp"
+#include "duckdb/planner/operator/logical_get.hpp"
+#include "duckdb/planner/operator/logical_limit.hpp"
+#include "duckdb/planner/operator/logical_projection.hpp"
+#include "duckdb/planner/operator/logical_top_n.hpp"
+
+namespace duckdb
+{
+
+    // Returns the read_notion scan directly below op, looking through a single projection. A filter in between
+    // stops the search, as a row limit pushed below it would be counted before the filter.
+    static optional_ptr<LogicalGet> find_notion_scan(LogicalOperator &op)
+    {
+        if (op.children.size() != 1)
+        {
+            return nullptr;
+        }
+        auto *child = op.children[0].get();
+        if (child->type == LogicalOperatorType::LOGICAL_PROJECTION)
+        {
+            child = child->children[0].get();
+        }
+        if (child->type != LogicalOperatorType::LOGICAL_GET)
+        {
+            return nullptr;
+        }
+        auto &get = child->Cast<LogicalGet>();
+        if (get.function.name != "read_notion")
+        {
+            return nullptr;
+        }
+        return &get;
+    }
+
+    // Resolves a column reference on top of op's child to the property it reads in the scan
+    static bool resolve_scan_column(const Expression &expr, LogicalOperator &child, LogicalGet &get, column_t &column_id)
+    {
+        if (expr.type != ExpressionType::BOUND_COLUMN_REF)
+        {
+            return false;
+        }
+        auto &colref = expr.Cast<BoundColumnRefExpression>();
+        if (child.type == LogicalOperatorType::LOGICAL_PROJECTION)
+        {
+            auto &projection = child.Cast<LogicalProjection>();
+            if (colref.binding.table_index != projection.table_index)
+            {
+                return false;
+            }
+            return resolve_scan_column(*projection.expressions[colref.binding.column_index], *projection.children[0], get, column_id);
+        }
+
+        if (colref.binding.table_index != get.table_index)
+        {
+            return false;
+        }
+        column_id = get.GetColumnIds()[colref.binding.column_index];
+        return column_id != COLUMN_IDENTIFIER_ROW_ID;
+    }
+
+    // Builds the Notion sort for an ORDER BY key. Only keys where Notion's ordering matches DuckDB's are
+    // pushed: numbers and dates, with empty values last. Text is left out as Notion sorts it by locale.
+    static bool translate_order(const NotionProperty &property, const BoundOrderByNode &order, json &sort)
+    {
+        if (order.null_order != OrderByNullType::NULLS_LAST)
+        {
+            return false;
+        }
+        auto direction = order.type == OrderType::DESCENDING ? "descending" : "ascending";
+
+        switch (property.type)
+        {
+        case NotionPropertyType::NUMBER:
+        case NotionPropertyType::DATE:
+            sort = {{"property", property.name}, {"direction", direction}};
+            return true;
+        case NotionPropertyType::CREATED_TIME:
+            sort = {{"timestamp", "created_time"}, {"direction", direction}};
+            return true;
+        case NotionPropertyType::LAST_EDITED_TIME:
+            sort = {{"timestamp", "last_edited_time"}, {"direction", direction}};
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static void push_top_n(LogicalTopN &top_n)
+    {
+        auto get = find_notion_scan(top_n);
+        if (!get)
+        {
+            return;
+        }
+        auto &bind_data = get->bind_data->Cast<NotionReadFunctionData>();
+
+        // Either every key is pushed or none: a prefix of the sort keys doesn't determine the top rows
+        json sorts = json::array();
+        for (auto &order : top_n.orders)
+        {
+            column_t column_id;
+            json sort;
+            // Date ranges order by their end as well, which Notion doesn't
+            if (!resolve_scan_column(*order.expression, *top_n.children[0], *get, column_id) ||
+                bind_data.types[column_id].IsNested() ||
+                !translate_order(bind_data.properties[column_id], order, sort))
+            {
+                return;
+            }
+            sorts.push_back(std::move(sort));
+        }
+
+        bind_data.sorts = std::move(sorts);
+        bind_data.row_limit = top_n.limit + top_n.offset;
+    }
+
+    static void push_limit(LogicalLimit &limit)
+    {
+        auto get = find_notion_scan(limit);
+        if (!get)
+        {
+            return;
+        }
+        if (limit.limit_val.Type() != LimitNodeType::CONSTANT_VALUE)
+        {
+            return;
+        }
+        idx_t offset = 0;
+        if (limit.offset_val.Type() == LimitNodeType::CONSTANT_VALUE)
+        {
+            offset = limit.offset_val.GetConstantValue();
+        }
+        else if (limit.offset_val.Type() != LimitNodeType::UNSET)
+        {
+            return;
+        }
+
+        auto &bind_data = get->bind_data->Cast<NotionReadFunctionData>();
+        bind_data.row_limit = limit.limit_val.GetConstantValue() + offset;
+    }
+
+    static void optimize_operator(LogicalOperator &op)
+    {
+        switch (op.type)
+        {
+        case LogicalOperatorType::LOGICAL_TOP_N:
+            push_top_n(op.Cast<LogicalTopN>());
+            break;
+        case LogicalOperatorType::LOGICAL_LIMIT:
+            push_limit(op.Cast<LogicalLimit>());
+            break;
+        default:
+            break;
+        }
+
+        for (auto &child : op.children)
+        {
+            optimize_operator(*child);
+        }
+    }
+
+    void notion_optimize_function(OptimizerExtensionInput &input, unique_ptr<LogicalOperator> &plan)
+    {
+        optimize_operator(*plan);
+    }
+
+} // namespace duckdb
@@ -0,0 +1,324 @@
+#include "notion_page_cache.hpp"
+#include "notion_read.hpp"
+#include "notion_filter.hpp"
+#include "notion_requests.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/file_system.hpp"
+#include "duckdb/common/types/hash.hpp"
+#include "duckdb/common/types/uuid.hpp"
+#include "duckdb/main/appender.hpp"
+#include "duckdb/parser/keyword_helper.hpp"
+#include "duckdb/storage/object_cache.hpp"
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+namespace duckdb
+{
+
+    //! Keeps track of when each entry was last fetched in full, and for which projection
+    static constexpr const char *ENTRIES_TABLE = "notion_page_cache_entries";
+
+    static unique_ptr<MaterializedQueryResult> run_query(Connection &con, const std::string &query)
+    {
+        auto result = con.Query(query);
+        if (result->HasError())
+        {
+            result->ThrowError();
+        }
+        return result;
+    }
+
+    // Fetches every page matching the filter, decoding it into the cache layout and appending it to the table
+    static void fetch_pages(ClientContext &context, const NotionReadFunctionData &bind_data, const NotionReadGlobalState &gstate,
+                            const NotionResponseLayout &layout, const vector<LogicalType> &types, const json &filter,
+                            Appender &appender)
+    {
+        DataChunk chunk;
+        chunk.Initialize(Allocator::Get(context), types, NOTION_MAX_PAGE_SIZE);
+        std::string next_cursor;
+        do
+        {
+            json request_body = {{"page_size", NOTION_MAX_PAGE_SIZE}};
+            if (!filter.is_null())
+            {
+                request_body["filter"] = filter;
+            }
+            if (!next_cursor.empty())
+            {
+                request_body["start_cursor"] = next_cursor;
+            }
+
+            auto response = query_database(context, *gstate.api, bind_data.database_id, request_body.dump(),
+                                           gstate.filter_properties);
+            chunk.Reset();
+            auto page = notion_parse_query_response(response, layout, chunk, 0, NOTION_MAX_PAGE_SIZE);
+            chunk.SetCardinality(page.row_count);
+            appender.AppendDataChunk(chunk);
+            gstate.api->buffers->Release(std::move(response));
+            next_cursor = page.has_more ? page.next_cursor : "";
+        } while (!next_cursor.empty());
+    }
+
+    NotionPageCache::NotionPageCache(shared_ptr<DuckDB> db_p) : db(std::move(db_p)), con(make_uniq<Connection>(*db))
+    {
+    }
+
+    static std::string get_page_cache_directory(ClientContext &context)
+    {
+        Value directory;
+        if (context.TryGetCurrentSetting("notion_page_cache_directory", directory) && !directory.IsNull())
+        {
+            return directory.ToString();
+        }
+        return "";
+    }
+
+    //! The database instances the cache files are opened in, one per cache file, shared by every scan of the
+    //! user's database instance. They are separate from the user's instance so the cache file never shows up in,
+    //! or stays attached to, its catalog.
+    class NotionPageCacheDatabases : public ObjectCacheEntry
+    {
+    public:
+        static shared_ptr<NotionPageCacheDatabases> Get(ClientContext &context)
+        {
+            auto &cache = ObjectCache::GetObjectCache(context);
+            return cache.GetOrCreate<NotionPageCacheDatabases>(ObjectType());
+        }
+
+        static string ObjectType()
+        {
+            return "notion_page_cache_databases";
+        }
+
+        string GetObjectType() override
+        {
+            return ObjectType();
+        }
+
+        //! Returns the database instance of the cache file, opening it on first use
+        shared_ptr<DuckDB> Open(const std::string &path)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto &db = databases[path];
+            if (!db)
+            {
+                db = make_shared_ptr<DuckDB>(path);
+            }
+            return db;
+        }
+
+    private:
+        std::mutex lock;
+        std::unordered_map<std::string, shared_ptr<DuckDB>> databases;
+    };
+
+    // Opens the cache file in the directory, returns null if it can't be opened
+    static shared_ptr<DuckDB> open_cache_file(ClientContext &context, const std::string &directory)
+    {
+        auto &fs = FileSystem::GetFileSystem(context);
+        auto path = fs.JoinPath(directory, "notion_page_cache.duckdb");
+        shared_ptr<DuckDB> db;
+        try
+        {
+            if (!fs.DirectoryExists(directory))
+            {
+                fs.CreateDirectory(directory);
+            }
+            db = NotionPageCacheDatabases::Get(context)->Open(path);
+        }
+        catch (IOException &)
+        {
+            // Most likely another process has the cache file open
+            return nullptr;
+        }
+        Connection con(*db);
+        run_query(con, "CREATE TABLE IF NOT EXISTS " + std::string(ENTRIES_TABLE) +
+                           " (name VARCHAR PRIMARY KEY, signature VARCHAR, refreshed_at TIMESTAMP)");
+        return db;
+    }
+
+    void NotionPageCache::Clear(ClientContext &context)
+    {
+        auto directory = get_page_cache_directory(context);
+        if (directory.empty())
+        {
+            return;
+        }
+        // Forgetting the entries makes the next scan of every entry fetch it in full
+        auto db = open_cache_file(context, directory);
+        if (db)
+        {
+            Connection con(*db);
+            run_query(con, "DELETE FROM " + std::string(ENTRIES_TABLE));
+        }
+    }
+
+    void NotionPageCache::Refresh(ClientContext &context, const NotionReadFunctionData &bind_data,
+                                  const NotionReadGlobalState &gstate, const std::string &table,
+                                  const std::string &signature, int64_t max_age_seconds)
+    {
+        // Cached rows are laid out as the page id, its last_edited_time and the projected properties in scan order
+        NotionResponseLayout layout;
+        vector<LogicalType> types = {LogicalType::VARCHAR, LogicalType::TIMESTAMP};
+        layout.page_field_columns["id"] = 0;
+        layout.page_field_columns["last_edited_time"] = 1;
+        layout.column_writers = {get_notion_page_id_writer(), get_notion_column_writer(NotionPropertyType::LAST_EDITED_TIME)};
+        std::string columns = "id VARCHAR, last_edited_time TIMESTAMP";
+        for (auto column_id : gstate.column_ids)
+        {
+            if (column_id == COLUMN_IDENTIFIER_ROW_ID || bind_data.properties[column_id].page_field)
+            {
+                continue;
+            }
+            auto column_index = types.size();
+            layout.property_columns[bind_data.properties[column_id].name] = column_index;
+            layout.column_writers.push_back(bind_data.column_writers[column_id]);
+            types.push_back(bind_data.types[column_id]);
+            columns += ", c" + std::to_string(column_index) + " " + bind_data.types[column_id].ToString();
+        }
+
+        auto quoted_table = KeywordHelper::WriteOptionallyQuoted(table);
+        auto fresh = run_query(*con, "SELECT signature = " + KeywordHelper::WriteQuoted(signature) +
+                                         " AND refreshed_at > now()::TIMESTAMP - to_seconds(" + std::to_string(max_age_seconds) +
+                                         ") FROM " + ENTRIES_TABLE + " WHERE name = " + KeywordHelper::WriteQuoted(table));
+        bool full_refresh = fresh->RowCount() == 0 || !BooleanValue::Get(fresh->GetValue(0, 0));
+
+        // Notion rounds last_edited_time down to the minute, so pages edited in the same minute as the newest
+        // cached one are fetched again and replace their cached copy
+        json filter;
+        if (!full_refresh)
+        {
+            auto watermark = run_query(*con, "SELECT max(last_edited_time) FROM " + quoted_table)->GetValue(0, 0);
+            if (!watermark.IsNull())
+            {
+                filter = notion_last_edited_since_filter(TimestampValue::Get(watermark));
+            }
+        }
+
+        // The pages are fetched into a staging table of this scan outside of any transaction, so the cache file
+        // isn't locked for writing while waiting on Notion. Only swapping them in is transactional.
+        auto staging_table = table + "_" + UUID::ToString(UUID::GenerateRandomUUID());
+        auto quoted_staging_table = KeywordHelper::WriteOptionallyQuoted(staging_table);
+        run_query(*con, "CREATE TABLE " + quoted_staging_table + " (" + columns + ")");
+        try
+        {
+            Appender appender(*con, "main", staging_table);
+            fetch_pages(context, bind_data, gstate, layout, types, filter, appender);
+            appender.Close();
+        }
+        catch (...)
+        {
+            run_query(*con, "DROP TABLE IF EXISTS " + quoted_staging_table);
+            throw;
+        }
+
+        con->BeginTransaction();
+        try
+        {
+            if (full_refresh)
+            {
+                run_query(*con, "DROP TABLE IF EXISTS " + quoted_table);
+                run_query(*con, "ALTER TABLE " + quoted_staging_table + " RENAME TO " + quoted_table);
+                run_query(*con, "INSERT OR REPLACE INTO " + std::string(ENTRIES_TABLE) + " VALUES (" +
+                                    KeywordHelper::WriteQuoted(table) + ", " + KeywordHelper::WriteQuoted(signature) +
+                                    ", now()::TIMESTAMP)");
+            }
+            else
+            {
+                run_query(*con, "DELETE FROM " + quoted_table + " WHERE id IN (SELECT id FROM " + quoted_staging_table + ")");
+                run_query(*con, "INSERT INTO " + quoted_table + " SELECT * FROM " + quoted_staging_table);
+                run_query(*con, "DROP TABLE " + quoted_staging_table);
+            }
+            con->Commit();
+        }
+        catch (std::exception &)
+        {
+            if (con->HasActiveTransaction())
+            {
+                con->Rollback();
+            }
+            run_query(*con, "DROP TABLE IF EXISTS " + quoted_staging_table);
+            throw;
+        }
+    }
+
+    unique_ptr<NotionPageCache> NotionPageCache::Open(ClientContext &context, const NotionReadFunctionData &bind_data,
+                                                      const NotionReadGlobalState &gstate)
+    {
+        auto directory = get_page_cache_directory(context);
+        if (directory.empty())
+        {
+            return nullptr;
+        }
+
+        int64_t max_age_seconds = NOTION_DEFAULT_PAGE_CACHE_MAX_AGE_SECONDS;
+        Value max_age_value;
+        if (context.TryGetCurrentSetting("notion_page_cache_max_age", max_age_value) && !max_age_value.IsNull())
+        {
+            max_age_seconds = max_age_value.GetValue<int64_t>();
+        }
+
+        auto db = open_cache_file(context, directory);
+        if (!db)
+        {
+            return nullptr;
+        }
+        auto cache = unique_ptr<NotionPageCache>(new NotionPageCache(std::move(db)));
+        auto &con = *cache->con;
+
+        // An entry holds the pages of a database as seen by one integration, for one set of projected properties
+        // and their types. The token is only kept as a hash.
+        std::string signature = bind_data.database_id + ":" + std::to_string(std::hash<std::string>()(bind_data.token));
+        std::string select_list;
+        idx_t property_index = 2;
+        for (auto column_id : gstate.column_ids)
+        {
+            std::string column;
+            if (column_id == COLUMN_IDENTIFIER_ROW_ID)
+            {
+                column = "rowid";
+            }
+            else if (bind_data.properties[column_id].page_field)
+            {
+                column = bind_data.properties[column_id].id;
+            }
+            else
+            {
+                column = "c" + std::to_string(property_index++);
+                signature += ";" + bind_data.properties[column_id].id + ":" + bind_data.types[column_id].ToString();
+            }
+            select_list += (select_list.empty() ? "" : ", ") + column;
+        }
+        auto table = "pages_" + std::to_string(Hash(signature.c_str()));
+
+        try
+        {
+            cache->Refresh(context, bind_data, gstate, table, signature, max_age_seconds);
+        }
+        catch (TransactionException &)
+        {
+            // A concurrent scan swapped in its pages at the same time
+            return nullptr;
+        }
+
+        cache->result = con.SendQuery("SELECT " + select_list + " FROM " + KeywordHelper::WriteOptionallyQuoted(table));
+        if (cache->result->HasError())
+        {
+            cache->result->ThrowError();
+        }
+        return cache;
+    }
+
+    bool NotionPageCache::Scan(DataChunk &output)
+    {
+        chunk = result->Fetch();
+        if (!chunk || chunk->size() == 0)
+        {
+            return false;
+        }
+        output.Reference(*chunk);
+        return true;
+    }
+
+} // namespace duckdb
@@ -0,0 +1,132 @@
+#include "notion_page_prefetcher.hpp"
+#include "duckdb/common/exception.hpp"
+#include "notion_query_parser.hpp"
+#include "notion_read.hpp"
+#include "notion_buffer_pool.hpp"
+#include "notion_requests.hpp"
+
+namespace duckdb
+{
+
+    NotionPagePrefetcher::NotionPagePrefetcher(ClientContext &context, shared_ptr<NotionApiContext> api_p,
+                                               std::string database_id_p, json request_p,
+                                               vector<string> filter_properties_p, idx_t depth_p,
+                                               NotionMetrics &scan_metrics)
+        : context(context), api(*api_p), database_id(std::move(database_id_p)),
+          request(std::move(request_p)), filter_properties(std::move(filter_properties_p)),
+          depth(MaxValue<idx_t>(depth_p, 1)), scan_metrics(scan_metrics)
+    {
+        api.cancelled = &cancelled;
+        fetcher = std::thread([this]()
+                              { Fetch(); });
+    }
+
+    NotionPagePrefetcher::~NotionPagePrefetcher()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopped = true;
+            cancelled = true;
+            for (auto &response : responses)
+            {
+                api.buffers->Release(std::move(response));
+            }
+            responses.clear();
+        }
+        space_available.notify_all();
+        // Waits for the rate limiter or a retry end right away. A request in flight is bounded by the socket
+        // timeouts of the connection pool.
+        fetcher.join();
+    }
+
+    void NotionPagePrefetcher::Fetch()
+    {
+        NotionMetricsScope metrics_scope(scan_metrics);
+        request["page_size"] = NOTION_MAX_PAGE_SIZE;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                space_available.wait(guard, [&]()
+                                     { return stopped || responses.size() < depth; });
+                if (stopped)
+                {
+                    return;
+                }
+            }
+
+            std::string response;
+            std::string next_cursor;
+            bool has_more;
+            try
+            {
+                response = query_database(context, api, database_id, request.dump(), filter_properties);
+                // Only the cursor is read here, the consumer decodes the results
+                has_more = notion_peek_pagination(response, next_cursor);
+            }
+            catch (std::exception &ex)
+            {
+                Fail(ErrorData(ex));
+                return;
+            }
+            catch (...)
+            {
+                Fail(ErrorData("Unknown error while prefetching pages from the Notion API"));
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                responses.push_back(std::move(response));
+                finished = !has_more;
+            }
+            response_available.notify_one();
+            if (!has_more)
+            {
+                return;
+            }
+            request["start_cursor"] = std::move(next_cursor);
+        }
+    }
+
+    void NotionPagePrefetcher::Fail(ErrorData failure)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        // Nothing waits for the error of a stopped prefetcher, which was most likely caused by stopping it
+        if (!stopped)
+        {
+            error = std::move(failure);
+        }
+        finished = true;
+        response_available.notify_one();
+    }
+
+    bool NotionPagePrefetcher::Next(std::string &response)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        // Wake up periodically to notice an interrupted query while a request is in flight
+        while (!response_available.wait_for(guard, std::chrono::milliseconds(100), [&]()
+                                            { return finished || !responses.empty(); }))
+        {
+            if (context.interrupted)
+            {
+                throw InterruptException();
+            }
+        }
+        if (!responses.empty())
+        {
+            response = std::move(responses.front());
+            responses.pop_front();
+            guard.unlock();
+            space_available.notify_one();
+            return true;
+        }
+        // The pages fetched before a failed request are consumed first
+        if (error.HasError())
+        {
+            error.Throw();
+        }
+        return false;
+    }
+
+} // namespace duckdb
@@ -0,0 +1,260 @@
+#include "notion_property_encoder.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/common/types/date.hpp"
+#include "duckdb/common/types/timestamp.hpp"
+
+namespace duckdb
+{
+
+    //! The maximum length of the content of a single rich text object
+    static constexpr idx_t NOTION_MAX_TEXT_LENGTH = 2000;
+
+    // Builds a rich text array, split into several text objects when the text is too long for one
+    static json text_runs(const std::string &text)
+    {
+        json runs = json::array();
+        idx_t position = 0;
+        while (position < text.size())
+        {
+            auto length = MinValue<idx_t>(NOTION_MAX_TEXT_LENGTH, text.size() - position);
+            // Don't split a UTF-8 sequence
+            while (position + length < text.size() && length > 1 &&
+                   (static_cast<unsigned char>(text[position + length]) & 0xC0) == 0x80)
+            {
+                length--;
+            }
+            runs.push_back({{"type", "text"}, {"text", {{"content", text.substr(position, length)}}}});
+            position += length;
+        }
+        return runs;
+    }
+
+    // Returns the text of a list entry. Users and files are read as structs, whose id or url identifies them.
+    static std::string entry_string(const Value &entry)
+    {
+        if (entry.type().id() != LogicalTypeId::STRUCT)
+        {
+            return entry.ToString();
+        }
+        auto &children = StructValue::GetChildren(entry);
+        for (auto key : {"id", "url"})
+        {
+            for (idx_t i = 0; i < children.size(); i++)
+            {
+                if (StructType::GetChildName(entry.type(), i) == key && !children[i].IsNull())
+                {
+                    return children[i].ToString();
+                }
+            }
+        }
+        return entry.ToString();
+    }
+
+    // Returns the entries of a LIST value, or of a comma separated string
+    static vector<std::string> value_entries(const Value &value)
+    {
+        vector<std::string> entries;
+        if (value.IsNull())
+        {
+            return entries;
+        }
+        if (value.type().id() == LogicalTypeId::LIST)
+        {
+            for (auto &child : ListValue::GetChildren(value))
+            {
+                if (!child.IsNull())
+                {
+                    entries.push_back(entry_string(child));
+                }
+            }
+            return entries;
+        }
+        for (auto &entry : StringUtil::Split(value.ToString(), ','))
+        {
+            StringUtil::Trim(entry);
+            if (!entry.empty())
+            {
+                entries.push_back(entry);
+            }
+        }
+        return entries;
+    }
+
+    static json encode_title(const Value &value)
+    {
+        return {{"title", value.IsNull() ? json::array() : text_runs(value.ToString())}};
+    }
+
+    static json encode_rich_text(const Value &value)
+    {
+        return {{"rich_text", value.IsNull() ? json::array() : text_runs(value.ToString())}};
+    }
+
+    static json encode_number(const Value &value)
+    {
+        if (value.IsNull())
+        {
+            return {{"number", nullptr}};
+        }
+        return {{"number", value.GetValue<double>()}};
+    }
+
+    static json encode_checkbox(const Value &value)
+    {
+        return {{"checkbox", !value.IsNull() && value.GetValue<bool>()}};
+    }
+
+    static json encode_date(const Value &value)
+    {
+        if (value.IsNull())
+        {
+            return {{"date", nullptr}};
+        }
+        std::string start;
+        switch (value.type().id())
+        {
+        case LogicalTypeId::STRUCT:
+        {
+            // A date range as read with date_ranges := true
+            json date = json::object();
+            auto &children = StructValue::GetChildren(value);
+            for (idx_t i = 0; i < children.size(); i++)
+            {
+                auto &child = children[i];
+                auto &name = StructType::GetChildName(value.type(), i);
+                if (child.IsNull())
+                {
+                    date[name] = nullptr;
+                }
+                else if (child.type().id() == LogicalTypeId::TIMESTAMP || child.type().id() == LogicalTypeId::TIMESTAMP_TZ)
+                {
+                    date[name] = notion_timestamp_to_iso8601(child.GetValue<timestamp_t>());
+                }
+                else
+                {
+                    date[name] = child.ToString();
+                }
+            }
+            return {{"date", std::move(date)}};
+        }
+        case LogicalTypeId::DATE:
+            start = Date::ToString(value.GetValue<date_t>());
+            break;
+        case LogicalTypeId::TIMESTAMP:
+        case LogicalTypeId::TIMESTAMP_TZ:
+            start = notion_timestamp_to_iso8601(value.GetValue<timestamp_t>());
+            break;
+        default:
+            // Strings are passed on as-is, Notion validates them
+            start = value.ToString();
+            break;
+        }
+        return {{"date", {{"start", start}}}};
+    }
+
+    static json encode_option(const char *type_key, const Value &value)
+    {
+        if (value.IsNull())
+        {
+            return {{type_key, nullptr}};
+        }
+        return {{type_key, {{"name", value.ToString()}}}};
+    }
+
+    static json encode_select(const Value &value)
+    {
+        return encode_option("select", value);
+    }
+
+    static json encode_status(const Value &value)
+    {
+        return encode_option("status", value);
+    }
+
+    static json encode_multi_select(const Value &value)
+    {
+        json options = json::array();
+        for (auto &entry : value_entries(value))
+        {
+            options.push_back({{"name", entry}});
+        }
+        return {{"multi_select", std::move(options)}};
+    }
+
+    // People and relations are given as the ids of the users or pages
+    template <const char *KEY>
+    static json encode_references(const Value &value)
+    {
+        json references = json::array();
+        for (auto &entry : value_entries(value))
+        {
+            references.push_back({{"id", entry}});
+        }
+        return {{KEY, std::move(references)}};
+    }
+
+    static json encode_files(const Value &value)
+    {
+        json files = json::array();
+        for (auto &url : value_entries(value))
+        {
+            files.push_back({{"name", url.substr(0, 100)}, {"type", "external"}, {"external", {{"url", url}}}});
+        }
+        return {{"files", std::move(files)}};
+    }
+
+    template <const char *KEY>
+    static json encode_nullable_string(const Value &value)
+    {
+        if (value.IsNull())
+        {
+            return {{KEY, nullptr}};
+        }
+        return {{KEY, value.ToString()}};
+    }
+
+    static constexpr const char URL_KEY[] = "url";
+    static constexpr const char EMAIL_KEY[] = "email";
+    static constexpr const char PHONE_NUMBER_KEY[] = "phone_number";
+    static constexpr const char PEOPLE_KEY[] = "people";
+    static constexpr const char RELATION_KEY[] = "relation";
+
+    notion_property_encoder_t get_notion_property_encoder(NotionPropertyType type)
+    {
+        switch (type)
+        {
+        case NotionPropertyType::TITLE:
+            return encode_title;
+        case NotionPropertyType::RICH_TEXT:
+            return encode_rich_text;
+        case NotionPropertyType::NUMBER:
+            return encode_number;
+        case NotionPropertyType::CHECKBOX:
+            return encode_checkbox;
+        case NotionPropertyType::DATE:
+            return encode_date;
+        case NotionPropertyType::SELECT:
+            return encode_select;
+        case NotionPropertyType::STATUS:
+            return encode_status;
+        case NotionPropertyType::MULTI_SELECT:
+            return encode_multi_select;
+        case NotionPropertyType::PEOPLE:
+            return encode_references<PEOPLE_KEY>;
+        case NotionPropertyType::RELATION:
+            return encode_references<RELATION_KEY>;
+        case NotionPropertyType::FILES:
+            return encode_files;
+        case NotionPropertyType::URL:
+            return encode_nullable_string<URL_KEY>;
+        case NotionPropertyType::EMAIL:
+            return encode_nullable_string<EMAIL_KEY>;
+        case NotionPropertyType::PHONE_NUMBER:
+            return encode_nullable_string<PHONE_NUMBER_KEY>;
+        default:
+            // Computed properties (formula, rollup, created_time, ...) are read-only
+            return nullptr;
+        }
+    }
+
+} // namespace duckdb
@@ -0,0 +1,539 @@
+#include "notion_query_parser.hpp"
+#include "duckdb/common/exception.hpp"
+
+namespace duckdb
+{
+
+    // Appends the size of every list in the vector, including nested ones, in the order reset_rows visits them
+    static void collect_list_sizes(Vector &result, vector<idx_t> &list_sizes)
+    {
+        switch (result.GetType().InternalType())
+        {
+        case PhysicalType::LIST:
+            list_sizes.push_back(ListVector::GetListSize(result));
+            collect_list_sizes(ListVector::GetEntry(result), list_sizes);
+            break;
+        case PhysicalType::STRUCT:
+            for (auto &child : StructVector::GetEntries(result))
+            {
+                collect_list_sizes(*child, list_sizes);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Marks the rows valid again and drops the list entries appended since the list sizes were collected,
+    // along with those of every nested vector, so the rows can be written once more
+    static void reset_rows(Vector &result, idx_t offset, idx_t count, const vector<idx_t> &list_sizes, idx_t &list_index)
+    {
+        auto &validity = FlatVector::Validity(result);
+        for (idx_t i = 0; i < count; i++)
+        {
+            validity.SetValid(offset + i);
+        }
+        switch (result.GetType().InternalType())
+        {
+        case PhysicalType::LIST:
+        {
+            auto list_size = list_sizes[list_index++];
+            auto &child = ListVector::GetEntry(result);
+            reset_rows(child, list_size, ListVector::GetListSize(result) - list_size, list_sizes, list_index);
+            ListVector::SetListSize(result, list_size);
+            break;
+        }
+        case PhysicalType::STRUCT:
+            for (auto &child : StructVector::GetEntries(result))
+            {
+                reset_rows(*child, offset, count, list_sizes, list_index);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Receives the SAX events of a query response, e.g.
+    // {"object": "list", "results": [{"id": "...", "properties": {"Name": {...}}}], "next_cursor": null, "has_more": false}
+    // The objects along the path to the property values are tracked on a stack of containers. Every other
+    // value is either skipped, or captured into a small json value when it is a projected property.
+    class NotionQueryResponseHandler : public json::json_sax_t
+    {
+    public:
+        NotionQueryResponseHandler(const NotionResponseLayout &layout, DataChunk &output, idx_t row_offset, idx_t capacity)
+            : layout(layout), output(output), row_offset(row_offset), capacity(capacity), written(layout.column_writers.size())
+        {
+            for (idx_t col_index = 0; col_index < output.ColumnCount(); col_index++)
+            {
+                collect_list_sizes(output.data[col_index], list_sizes);
+            }
+        }
+
+        bool null() override
+        {
+            return ScalarValue(json());
+        }
+
+        bool boolean(bool val) override
+        {
+            return ScalarValue(val);
+        }
+
+        bool number_integer(number_integer_t val) override
+        {
+            return ScalarValue(val);
+        }
+
+        bool number_unsigned(number_unsigned_t val) override
+        {
+            return ScalarValue(val);
+        }
+
+        bool number_float(number_float_t val, const string_t &) override
+        {
+            return ScalarValue(val);
+        }
+
+        bool string(string_t &val) override
+        {
+            return ScalarValue(std::move(val));
+        }
+
+        bool binary(binary_t &) override
+        {
+            return ScalarValue(json());
+        }
+
+        bool start_object(std::size_t) override
+        {
+            if (skip_depth > 0)
+            {
+                skip_depth++;
+                return true;
+            }
+            if (!capture_stack.empty())
+            {
+                OpenCaptureContainer(json::object());
+                return true;
+            }
+
+            switch (NextValueTarget())
+            {
+            case Target::ROOT:
+                containers.push_back(Container::ROOT);
+                break;
+            case Target::PAGE:
+                containers.push_back(Container::PAGE);
+                BeginRow();
+                break;
+            case Target::PROPERTIES:
+                containers.push_back(Container::PROPERTIES);
+                page_has_properties = true;
+                break;
+            case Target::CAPTURE:
+                captured = json::object();
+                capture_stack.push_back(&captured);
+                break;
+            default:
+                skip_depth = 1;
+                break;
+            }
+            return true;
+        }
+
+        bool key(string_t &val) override
+        {
+            if (skip_depth > 0)
+            {
+                return true;
+            }
+            if (!capture_stack.empty())
+            {
+                capture_key = std::move(val);
+                return true;
+            }
+
+            pending = Target::SKIP;
+            switch (containers.back())
+            {
+            case Container::ROOT:
+                if (val == "results")
+                {
+                    pending = Target::RESULTS;
+                }
+                else if (val == "has_more")
+                {
+                    pending = Target::HAS_MORE;
+                }
+                else if (val == "next_cursor")
+                {
+                    pending = Target::NEXT_CURSOR;
+                }
+                break;
+            case Container::PAGE:
+            {
+                if (val == "properties")
+                {
+                    pending = Target::PROPERTIES;
+                    break;
+                }
+                auto entry = layout.page_field_columns.find(val);
+                if (entry != layout.page_field_columns.end())
+                {
+                    pending = Target::CAPTURE;
+                    capture_column = entry->second;
+                    page_field_key = std::move(val);
+                }
+                break;
+            }
+            case Container::PROPERTIES:
+            {
+                auto entry = layout.property_columns.find(val);
+                if (entry != layout.property_columns.end())
+                {
+                    pending = Target::CAPTURE;
+                    capture_column = entry->second;
+                    page_field_key.clear();
+                }
+                break;
+            }
+            default:
+                break;
+            }
+            return true;
+        }
+
+        bool end_object() override
+        {
+            return EndContainer();
+        }
+
+        bool start_array(std::size_t) override
+        {
+            if (skip_depth > 0)
+            {
+                skip_depth++;
+                return true;
+            }
+            if (!capture_stack.empty())
+            {
+                OpenCaptureContainer(json::array());
+                return true;
+            }
+
+            switch (NextValueTarget())
+            {
+            case Target::RESULTS:
+                containers.push_back(Container::RESULTS);
+                has_results = true;
+                break;
+            case Target::CAPTURE:
+                captured = json::array();
+                capture_stack.push_back(&captured);
+                break;
+            default:
+                skip_depth = 1;
+                break;
+            }
+            return true;
+        }
+
+        bool end_array() override
+        {
+            return EndContainer();
+        }
+
+        bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &ex) override
+        {
+            error = ex.what();
+            return false;
+        }
+
+        //! Undoes the writes to every row slot touched so far, so the rows can be written once more
+        void ResetRows()
+        {
+            auto touched = MinValue<idx_t>(page.row_count + (in_row ? 1 : 0), capacity);
+            idx_t list_index = 0;
+            for (idx_t col_index = 0; col_index < output.ColumnCount(); col_index++)
+            {
+                reset_rows(output.data[col_index], row_offset, touched, list_sizes, list_index);
+            }
+        }
+
+    public:
+        NotionQueryPage page;
+        bool has_results = false;
+        std::string error;
+
+    private:
+        enum class Container : uint8_t
+        {
+            ROOT,
+            RESULTS,
+            PAGE,
+            PROPERTIES
+        };
+
+        //! What the next value is used for
+        enum class Target : uint8_t
+        {
+            ROOT,
+            RESULTS,
+            HAS_MORE,
+            NEXT_CURSOR,
+            PAGE,
+            PROPERTIES,
+            CAPTURE,
+            SKIP
+        };
+
+        Target NextValueTarget() const
+        {
+            if (containers.empty())
+            {
+                return Target::ROOT;
+            }
+            if (containers.back() == Container::RESULTS)
+            {
+                return Target::PAGE;
+            }
+            return pending;
+        }
+
+        bool ScalarValue(json &&value)
+        {
+            if (skip_depth > 0)
+            {
+                return true;
+            }
+            if (!capture_stack.empty())
+            {
+                auto &parent = *capture_stack.back();
+                if (parent.is_array())
+                {
+                    parent.push_back(std::move(value));
+                }
+                else
+                {
+                    parent[capture_key] = std::move(value);
+                }
+                return true;
+            }
+
+            switch (NextValueTarget())
+            {
+            case Target::HAS_MORE:
+                page.has_more = value.is_boolean() && value.get<bool>();
+                break;
+            case Target::NEXT_CURSOR:
+                if (value.is_string())
+                {
+                    page.next_cursor = value.get<std::string>();
+                }
+                break;
+            case Target::CAPTURE:
+                captured = std::move(value);
+                WriteCaptured();
+                break;
+            default:
+                break;
+            }
+            return true;
+        }
+
+        void OpenCaptureContainer(json &&container)
+        {
+            auto &parent = *capture_stack.back();
+            json *child;
+            if (parent.is_array())
+            {
+                parent.push_back(std::move(container));
+                child = &parent.back();
+            }
+            else
+            {
+                child = &(parent[capture_key] = std::move(container));
+            }
+            capture_stack.push_back(child);
+        }
+
+        bool EndContainer()
+        {
+            if (skip_depth > 0)
+            {
+                skip_depth--;
+                return true;
+            }
+            if (!capture_stack.empty())
+            {
+                capture_stack.pop_back();
+                if (capture_stack.empty())
+                {
+                    WriteCaptured();
+                }
+                return true;
+            }
+
+            auto container = containers.back();
+            containers.pop_back();
+            if (container == Container::PAGE)
+            {
+                EndRow();
+            }
+            return true;
+        }
+
+        void BeginRow()
+        {
+            if (page.row_count >= capacity)
+            {
+                throw IOException("Invalid response from Notion API: more results than the requested page size");
+            }
+            std::fill(written.begin(), written.end(), false);
+            page_has_properties = false;
+            in_row = true;
+        }
+
+        void WriteCaptured()
+        {
+            auto row_index = row_offset + page.row_count;
+            auto writer = layout.column_writers[capture_column];
+            if (page_field_key.empty())
+            {
+                writer(captured, output.data[capture_column], row_index);
+            }
+            else
+            {
+                // Page field writers read their field from the page object
+                json page_field = {{page_field_key, std::move(captured)}};
+                writer(page_field, output.data[capture_column], row_index);
+            }
+            written[capture_column] = true;
+            captured = json();
+        }
+
+        void EndRow()
+        {
+            in_row = false;
+            auto row_index = row_offset + page.row_count;
+            if (!page_has_properties)
+            {
+                // Not a page of the database. Release the slot for the next row.
+                for (idx_t col_index = 0; col_index < written.size(); col_index++)
+                {
+                    FlatVector::Validity(output.data[col_index]).SetValid(row_index);
+                }
+                return;
+            }
+            for (idx_t col_index = 0; col_index < written.size(); col_index++)
+            {
+                if (!written[col_index] && layout.column_writers[col_index])
+                {
+                    FlatVector::SetNull(output.data[col_index], row_index, true);
+                }
+            }
+            page.row_count++;
+        }
+
+    private:
+        const NotionResponseLayout &layout;
+        DataChunk &output;
+        idx_t row_offset;
+        idx_t capacity;
+
+        vector<Container> containers;
+        //! The target of the value following the last key
+        Target pending = Target::SKIP;
+        //! The nesting depth inside a value that is being skipped
+        idx_t skip_depth = 0;
+
+        //! The value being captured and the path to the innermost container currently open in it
+        json captured;
+        vector<json *> capture_stack;
+        std::string capture_key;
+        idx_t capture_column = 0;
+        //! The key of the captured page field, empty when capturing a property value
+        std::string page_field_key;
+
+        //! The size of every list in the output before any row was written, see collect_list_sizes
+        vector<idx_t> list_sizes;
+        //! Whether each column has been written for the current row
+        vector<bool> written;
+        bool page_has_properties = false;
+        bool in_row = false;
+    };
+
+    NotionQueryPage notion_parse_query_response(const std::string &response, const NotionResponseLayout &layout,
+                                                DataChunk &output, idx_t row_offset, idx_t capacity)
+    {
+        NotionQueryResponseHandler handler(layout, output, row_offset, capacity);
+        if (!json::sax_parse(response, &handler))
+        {
+            // Control characters are invalid in JSON strings. Only when the response contains any is it
+            // copied to strip them, and decoded again from the start.
+            handler.ResetRows();
+            auto first_error = handler.error;
+            NotionQueryResponseHandler retry_handler(layout, output, row_offset, capacity);
+            if (!json::sax_parse(clean_json_control_characters(response), &retry_handler))
+            {
+                throw IOException("Failed to parse Notion API response: %s", first_error);
+            }
+            handler.page = std::move(retry_handler.page);
+            handler.has_results = retry_handler.has_results;
+        }
+
+        if (!handler.has_results)
+        {
+            throw IOException("Invalid response from Notion API: no results found");
+        }
+        return std::move(handler.page);
+    }
+
+    // Returns the position of the value of a top-level key that follows the results array, or npos
+    static std::size_t find_trailing_value(const std::string &response, const std::string &key, std::size_t results_end)
+    {
+        auto position = response.rfind("\"" + key + "\":");
+        if (position == std::string::npos || results_end == std::string::npos || position < results_end)
+        {
+            return std::string::npos;
+        }
+        position += key.size() + 3;
+        while (position < response.size() && (response[position] == ' ' || response[position] == '\n'))
+        {
+            position++;
+        }
+        return position;
+    }
+
+    bool notion_peek_pagination(const std::string &response, std::string &next_cursor)
+    {
+        // The results array closes with the last ']', as no array follows it
+        auto results_end = response.rfind(']');
+        auto has_more_value = find_trailing_value(response, "has_more", results_end);
+        auto next_cursor_value = find_trailing_value(response, "next_cursor", results_end);
+        if (has_more_value != std::string::npos && next_cursor_value != std::string::npos)
+        {
+            if (response.compare(has_more_value, 5, "false") == 0 || response.compare(next_cursor_value, 4, "null") == 0)
+            {
+                next_cursor.clear();
+                return false;
+            }
+            // Cursors are UUIDs, so the string holds no escapes
+            auto cursor_end = response.find('"', next_cursor_value + 1);
+            if (response.compare(has_more_value, 4, "true") == 0 && response[next_cursor_value] == '"' &&
+                cursor_end != std::string::npos)
+            {
+                next_cursor = response.substr(next_cursor_value + 1, cursor_end - next_cursor_value - 1);
+                return !next_cursor.empty();
+            }
+        }
+
+        auto parsed = parse_json(response);
+        next_cursor = parsed.value("has_more", false) && parsed["next_cursor"].is_string()
+                          ? parsed["next_cursor"].get<std::string>()
+                          : "";
+        return !next_cursor.empty();
+    }
+
+} // namespace duckdb
@@ -0,0 +1,82 @@
+#include "notion_rate_limiter.hpp"
+#include "duckdb/common/exception.hpp"
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+namespace duckdb
+{
+
+    //! The longest a sleeping request goes without checking whether its query was interrupted
+    static constexpr std::chrono::milliseconds INTERRUPT_CHECK_INTERVAL(100);
+
+    void notion_interruptible_sleep(ClientContext &context, std::chrono::steady_clock::duration duration,
+                                    const std::atomic<bool> *cancelled)
+    {
+        auto until = std::chrono::steady_clock::now() + duration;
+        while (true)
+        {
+            if (context.interrupted || (cancelled && *cancelled))
+            {
+                throw InterruptException();
+            }
+            auto now = std::chrono::steady_clock::now();
+            if (now >= until)
+            {
+                return;
+            }
+            std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(until - now, INTERRUPT_CHECK_INTERVAL));
+        }
+    }
+
+    NotionRateLimiter::NotionRateLimiter()
+        : tokens(NOTION_DEFAULT_REQUEST_BURST), last_refill(std::chrono::steady_clock::now()), paused_until(last_refill)
+    {
+    }
+
+    shared_ptr<NotionRateLimiter> NotionRateLimiter::Get(ClientContext &context, const std::string &token)
+    {
+        // Key on a hash so the token itself isn't kept around in the cache
+        auto &cache = ObjectCache::GetObjectCache(context);
+        return cache.GetOrCreate<NotionRateLimiter>(ObjectType() + ":" + std::to_string(std::hash<std::string>()(token)));
+    }
+
+    void NotionRateLimiter::Acquire(ClientContext &context, double requests_per_second, idx_t burst,
+                                    const std::atomic<bool> *cancelled)
+    {
+        std::chrono::steady_clock::duration wait(0);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto now = std::chrono::steady_clock::now();
+            std::chrono::duration<double> elapsed = now - last_refill;
+            tokens = std::min<double>(static_cast<double>(burst), tokens + elapsed.count() * requests_per_second);
+            last_refill = now;
+
+            // Reserve a slot. A deficit means earlier callers hold the next slots, so wait for ours.
+            tokens -= 1;
+            if (tokens < 0)
+            {
+                wait = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(-tokens / requests_per_second));
+            }
+            if (paused_until > now)
+            {
+                wait = std::max<std::chrono::steady_clock::duration>(wait, paused_until - now);
+            }
+        }
+        if (wait.count() > 0)
+        {
+            notion_interruptible_sleep(context, wait, cancelled);
+        }
+    }
+
+    void NotionRateLimiter::Pause(std::chrono::milliseconds delay)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto now = std::chrono::steady_clock::now();
+        paused_until = std::max(paused_until, now + delay);
+        // Resume at the steady rate instead of sending a burst the moment the pause ends
+        tokens = std::min(tokens, 0.0);
+    }
+
+} // namespace duckdb
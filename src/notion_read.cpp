@@ -1,9 +1,16 @@
 #include "duckdb/common/exception.hpp"
 #include "duckdb/common/string_util.hpp"
-#include "duckdb/main/secret/secret_manager.hpp"
+#include "duckdb/optimizer/filter_combiner.hpp"
+#include "duckdb/parser/expression/constant_expression.hpp"
+#include "duckdb/parser/expression/function_expression.hpp"
+#include "duckdb/parser/tableref/table_function_ref.hpp"
 #include "notion_requests.hpp"
 #include "notion_utils.hpp"
 #include "notion_read.hpp"
+#include "notion_filter.hpp"
+#include "notion_column_writer.hpp"
+#include "notion_schema_cache.hpp"
+#include "notion_auth.hpp"
 #include <json.hpp>
 
 namespace duckdb
@@ -11,196 +18,799 @@ namespace duckdb
 
     using json = nlohmann::json;
 
-    std::string get_notion_token(ClientContext &context)
+    // Appends the conditions of the filter to terms, splicing in the members of nested "and"s
+    static void flatten_and(const json &filter, vector<json> &terms)
     {
-        // Use the SecretManager to get the token
-        auto &secret_manager = SecretManager::Get(context);
-        auto transaction = CatalogTransaction::GetSystemCatalogTransaction(context);
-        auto secret_match = secret_manager.LookupSecret(transaction, "notion", "notion");
+        if (filter.is_object() && filter.contains("and"))
+        {
+            for (auto &condition : filter["and"])
+            {
+                flatten_and(condition, terms);
+            }
+            return;
+        }
+        terms.push_back(filter);
+    }
 
-        if (!secret_match.HasMatch())
+    // The number of compound filters a filter is nested in, 0 for a single condition
+    static idx_t filter_depth(const json &filter)
+    {
+        idx_t depth = 0;
+        for (auto compound : {"and", "or"})
         {
-            throw InvalidInputException("No 'notion' secret found. Please create a secret with 'CREATE SECRET' first.");
+            if (filter.is_object() && filter.contains(compound))
+            {
+                for (auto &condition : filter[compound])
+                {
+                    depth = MaxValue<idx_t>(depth, filter_depth(condition) + 1);
+                }
+            }
         }
+        return depth;
+    }
 
-        auto &secret = secret_match.GetSecret();
-        if (secret.GetType() != "notion")
+    // The number of single conditions of a filter
+    static idx_t filter_condition_count(const json &filter)
+    {
+        idx_t count = 0;
+        for (auto compound : {"and", "or"})
         {
-            throw InvalidInputException("Invalid secret type. Expected 'notion', got '%s'", secret.GetType());
+            if (filter.is_object() && filter.contains(compound))
+            {
+                for (auto &condition : filter[compound])
+                {
+                    count += filter_condition_count(condition);
+                }
+                return count;
+            }
         }
+        return 1;
+    }
 
-        const auto *kv_secret = dynamic_cast<const KeyValueSecret *>(&secret);
-        if (!kv_secret)
+    // Combines the filter pushed down from the WHERE clause with conditions that have to be sent, such as
+    // since :=, filter := and the range of a slice. Both are flattened into one "and" so the result stays within
+    // the two levels of nesting Notion allows. Pushed conditions that would go beyond that, or beyond
+    // NOTION_MAX_FILTER_CONDITIONS, are left out: DuckDB evaluates the WHERE clause on the returned rows anyway.
+    static json combine_filters(const json &pushed_filter, const vector<json> &conditions)
+    {
+        vector<json> required;
+        idx_t condition_count = 0;
+        for (auto &condition : conditions)
+        {
+            flatten_and(condition, required);
+        }
+        for (auto &condition : required)
         {
-            throw InvalidInputException("Invalid secret format for 'notion' secret");
+            condition_count += filter_condition_count(condition);
         }
 
-        Value token_value;
-        if (!kv_secret->TryGetValue("token", token_value))
+        json combined = json::array();
+        if (!pushed_filter.is_null())
+        {
+            vector<json> pushed;
+            flatten_and(pushed_filter, pushed);
+            for (auto &condition : pushed)
+            {
+                auto count = filter_condition_count(condition);
+                if (filter_depth(condition) > 1 || condition_count + count > NOTION_MAX_FILTER_CONDITIONS)
+                {
+                    continue;
+                }
+                condition_count += count;
+                combined.push_back(std::move(condition));
+            }
+        }
+        for (auto &condition : required)
         {
-            throw InvalidInputException("'token' not found in 'notion' secret");
+            combined.push_back(std::move(condition));
         }
 
-        std::string token = token_value.ToString();
-        return token;
+        if (combined.empty())
+        {
+            return json();
+        }
+        if (combined.size() == 1)
+        {
+            return combined[0];
+        }
+        return {{"and", std::move(combined)}};
     }
 
-    // https://developers.notion.com/reference/property-object
-    static LogicalType notion_type_to_duckdb_type(const std::string &notion_type)
+    // Builds the body of the query requests of a cursor, without page_size and start_cursor
+    static json query_request(const NotionReadFunctionData &bind_data, const json &filter)
     {
-        if (notion_type == "title" || notion_type == "rich_text" ||
-            notion_type == "url" || notion_type == "email" ||
-            notion_type == "phone_number" || notion_type == "select" ||
-            notion_type == "multi_select" || notion_type == "status")
+        json request_body = json::object();
+        if (!filter.is_null())
         {
-            return LogicalType::VARCHAR;
+            request_body["filter"] = filter;
         }
-        else if (notion_type == "number")
+        if (!bind_data.sorts.empty())
         {
-            return LogicalType::DOUBLE;
+            request_body["sorts"] = bind_data.sorts;
         }
-        else if (notion_type == "checkbox")
+        return request_body;
+    }
+
+    // Requests the next page of the cursor's query, or takes it from the cursor's prefetcher, and decodes its
+    // rows into the output, starting at row_index. Returns false once the last page has been consumed.
+    static bool fetch_next_page(ClientContext &context, const NotionReadFunctionData &bind_data,
+                                NotionReadGlobalState &gstate, NotionScanCursor &cursor, DataChunk &output,
+                                idx_t &row_index)
+    {
+        if (!cursor.has_more)
         {
-            return LogicalType::BOOLEAN;
+            return false;
         }
-        else if (notion_type == "date" || notion_type == "created_time" ||
-                 notion_type == "last_edited_time")
+
+        // With a pushed down limit, stop once enough rows have been fetched and don't request more than needed
+        idx_t page_size = NOTION_MAX_PAGE_SIZE;
+        if (bind_data.row_limit != DConstants::INVALID_INDEX)
         {
-            return LogicalType::TIMESTAMP;
+            if (cursor.rows_fetched >= bind_data.row_limit)
+            {
+                cursor.has_more = false;
+                return false;
+            }
+            page_size = MinValue<idx_t>(page_size, bind_data.row_limit - cursor.rows_fetched);
         }
-        else if (notion_type == "people" || notion_type == "created_by" ||
-                 notion_type == "last_edited_by" || notion_type == "files" ||
-                 notion_type == "relation")
+
+        std::string response;
+        if (cursor.prefetcher)
         {
-            // These types contain complex objects, return as JSON strings
-            return LogicalType::VARCHAR;
+            if (!cursor.prefetcher->Next(response))
+            {
+                cursor.has_more = false;
+                return false;
+            }
         }
-        else if (notion_type == "formula" || notion_type == "rollup")
+        else
         {
-            // Formula and rollup types can have different return types
-            // For simplicity, return as VARCHAR and let the user parse if needed
-            return LogicalType::VARCHAR;
+            auto request_body = query_request(bind_data, cursor.filter);
+            request_body["page_size"] = page_size;
+            if (!cursor.next_cursor.empty())
+            {
+                request_body["start_cursor"] = cursor.next_cursor;
+            }
+            response = query_database(context, *gstate.api, bind_data.database_id, request_body.dump(),
+                                      gstate.filter_properties);
         }
+        auto parse_start = std::chrono::steady_clock::now();
+        auto page = notion_parse_query_response(response, gstate.layout, output, row_index, page_size);
+        notion_record_metric(*gstate.api->metrics, &NotionMetrics::parse_us, notion_elapsed_us(parse_start));
+        // The values were copied into the vectors, so the buffer can take the next response
+        gstate.api->buffers->Release(std::move(response));
+        notion_record_metric(*gstate.api->metrics, &NotionMetrics::rows, page.row_count);
 
-        // Default to VARCHAR for unknown types
-        return LogicalType::VARCHAR;
+        row_index += page.row_count;
+        cursor.rows_fetched += page.row_count;
+        gstate.rows_fetched += page.row_count;
+        cursor.has_more = page.has_more && !page.next_cursor.empty();
+        cursor.next_cursor = std::move(page.next_cursor);
+        return true;
     }
 
-    // TODO
-    void notion_read_function(ClientContext &context, TableFunctionInput &data_p, DataChunk &output)
+    // Builds a condition on the partition column: the page's created_time or a date property
+    static json partition_condition(const NotionProperty *property, const char *condition, timestamp_t bound)
     {
-        auto &bind_data = const_cast<NotionReadFunctionData &>(data_p.bind_data->Cast<NotionReadFunctionData>());
-        std::string database_id = bind_data.database_id;
-        std::string token = get_notion_token(context);
+        if (!property)
+        {
+            return {{"timestamp", "created_time"}, {"created_time", {{condition, notion_timestamp_to_iso8601(bound)}}}};
+        }
+        // Date properties may hold dates without a time, so slice on whole days
+        return {{"property", property->name}, {"date", {{condition, Date::ToString(Timestamp::GetDate(bound))}}}};
+    }
 
-        // Query the database
-        std::string response = query_database(token, database_id);
-        auto json_response = parse_json(response);
+    // Finds the smallest or largest value of the partition column among the pages matching the filter
+    static bool probe_partition_bound(ClientContext &context, const NotionReadFunctionData &bind_data,
+                                      const NotionReadGlobalState &gstate, const NotionProperty *property,
+                                      bool descending, timestamp_t &result)
+    {
+        auto direction = descending ? "descending" : "ascending";
+        json sort;
+        vector<json> conditions;
+        vector<string> filter_properties;
+        if (!property)
+        {
+            sort = {{"timestamp", "created_time"}, {"direction", direction}};
+            filter_properties.push_back("title");
+        }
+        else
+        {
+            sort = {{"property", property->name}, {"direction", direction}};
+            conditions.push_back({{"property", property->name}, {"date", {{"is_not_empty", true}}}});
+            filter_properties.push_back(property->id);
+        }
 
-        if (!json_response.contains("results"))
+        json request_body = {{"page_size", 1}, {"sorts", json::array({sort})}};
+        conditions.insert(conditions.begin(), gstate.required_filters.begin(), gstate.required_filters.end());
+        auto filter = combine_filters(gstate.pushed_filter, conditions);
+        if (!filter.is_null())
         {
-            throw IOException("Invalid response from Notion API: no results found");
+            request_body["filter"] = filter;
         }
 
-        // Process each page/row
-        auto &results = json_response["results"];
+        auto response = parse_json(query_database(context, *gstate.api, bind_data.database_id, request_body.dump(),
+                                                  filter_properties));
+        if (!response.contains("results") || response["results"].empty())
+        {
+            return false;
+        }
+
+        auto &page = response["results"][0];
+        std::string value;
+        if (!property)
+        {
+            value = page["created_time"].get<std::string>();
+        }
+        else
+        {
+            auto &date = page["properties"][property->name]["date"];
+            if (date.is_null())
+            {
+                return false;
+            }
+            value = date["start"].get<std::string>();
+        }
+        return Timestamp::TryConvertTimestamp(value.c_str(), value.size(), result) == TimestampCastResult::SUCCESS;
+    }
+
+    // Splits the query into disjoint slices on the partition column so they can be paginated in parallel.
+    // Two cheap probes find the range of the column, which is cut into equally wide slices. The first and
+    // last slices are open-ended, so pages outside the probed range (e.g. created during the scan) are
+    // still read exactly once.
+    static vector<json> partition_scan(ClientContext &context, const NotionReadFunctionData &bind_data,
+                                       const NotionReadGlobalState &gstate)
+    {
+        vector<json> slices;
+        const NotionProperty *property = nullptr;
+        if (bind_data.partition_property != DConstants::INVALID_INDEX &&
+            bind_data.properties[bind_data.partition_property].type == NotionPropertyType::DATE)
+        {
+            property = &bind_data.properties[bind_data.partition_property];
+        }
+
+        timestamp_t min_value, max_value;
+        if (!probe_partition_bound(context, bind_data, gstate, property, false, min_value) ||
+            !probe_partition_bound(context, bind_data, gstate, property, true, max_value))
+        {
+            slices.push_back(gstate.query_filter);
+            return slices;
+        }
+
+        int64_t granularity = property ? Interval::MICROS_PER_DAY : 60 * Interval::MICROS_PER_SEC;
+        int64_t low = Timestamp::GetEpochMicroSeconds(min_value);
+        int64_t high = Timestamp::GetEpochMicroSeconds(max_value);
+        vector<timestamp_t> boundaries;
+        for (idx_t i = 1; i < bind_data.partitions; i++)
+        {
+            auto boundary = low + static_cast<int64_t>(static_cast<double>(high - low) * i / bind_data.partitions);
+            boundary -= ((boundary % granularity) + granularity) % granularity;
+            if (boundary <= low || (!boundaries.empty() && boundary <= Timestamp::GetEpochMicroSeconds(boundaries.back())))
+            {
+                continue;
+            }
+            boundaries.push_back(Timestamp::FromEpochMicroSeconds(boundary));
+        }
+
+        for (idx_t i = 0; i <= boundaries.size(); i++)
+        {
+            auto conditions = gstate.required_filters;
+            if (i > 0)
+            {
+                conditions.push_back(partition_condition(property, "on_or_after", boundaries[i - 1]));
+            }
+            if (i < boundaries.size())
+            {
+                conditions.push_back(partition_condition(property, "before", boundaries[i]));
+            }
+            slices.push_back(combine_filters(gstate.pushed_filter, conditions));
+        }
+        if (property)
+        {
+            // Pages without a date fall outside every range
+            auto conditions = gstate.required_filters;
+            conditions.push_back({{"property", property->name}, {"date", {{"is_empty", true}}}});
+            slices.push_back(combine_filters(gstate.pushed_filter, conditions));
+        }
+        return slices;
+    }
+
+    NotionReadGlobalState::~NotionReadGlobalState()
+    {
+        if (instance_metrics)
+        {
+            instance_metrics->StoreLastScan(metrics);
+        }
+    }
+
+    unique_ptr<GlobalTableFunctionState> notion_init_global(ClientContext &context, TableFunctionInitInput &input)
+    {
+        auto &bind_data = input.bind_data->Cast<NotionReadFunctionData>();
+        auto result = make_uniq<NotionReadGlobalState>();
+        result->instance_metrics = NotionInstanceMetrics::Get(context);
+        // The probes of a partitioned scan count towards the scan
+        NotionMetricsScope metrics_scope(result->metrics);
+        result->token = bind_data.token;
+        result->api = make_shared_ptr<NotionApiContext>(context, result->token);
+        result->column_ids = input.column_ids;
+        Value prefetch_pages;
+        if (context.TryGetCurrentSetting("notion_prefetch_pages", prefetch_pages) && !prefetch_pages.IsNull())
+        {
+            result->prefetch_pages = MaxValue<int64_t>(prefetch_pages.GetValue<int64_t>(), 0);
+        }
+        // A lower bound would have the progress bar run past 100%, so progress is only reported on exact counts
+        bool is_lower_bound;
+        result->estimated_rows = NotionSchemaCache::Get(context)->GetRowCount(result->token, bind_data.database_id,
+                                                                              is_lower_bound);
+        if (is_lower_bound)
+        {
+            result->estimated_rows = DConstants::INVALID_INDEX;
+        }
+        if (result->estimated_rows != DConstants::INVALID_INDEX && bind_data.row_limit != DConstants::INVALID_INDEX)
+        {
+            result->estimated_rows = MinValue<idx_t>(result->estimated_rows, bind_data.row_limit);
+        }
+
+        for (auto column_id : input.column_ids)
+        {
+            if (column_id == COLUMN_IDENTIFIER_ROW_ID || bind_data.properties[column_id].page_field)
+            {
+                continue;
+            }
+            result->filter_properties.push_back(bind_data.properties[column_id].id);
+        }
+        result->pushed_filter = bind_data.pushed_filter;
+        if (!bind_data.since_filter.is_null())
+        {
+            result->required_filters.push_back(bind_data.since_filter);
+        }
+        if (!bind_data.user_filter.is_null())
+        {
+            result->required_filters.push_back(bind_data.user_filter);
+        }
+        result->query_filter = combine_filters(result->pushed_filter, result->required_filters);
+        result->layout.column_writers.resize(input.column_ids.size());
+        for (idx_t col_index = 0; col_index < input.column_ids.size(); col_index++)
+        {
+            auto column_id = input.column_ids[col_index];
+            if (column_id == COLUMN_IDENTIFIER_ROW_ID)
+            {
+                continue;
+            }
+            auto &property = bind_data.properties[column_id];
+            if (property.page_field)
+            {
+                result->layout.page_field_columns[property.id] = col_index;
+            }
+            else
+            {
+                result->layout.property_columns[property.name] = col_index;
+            }
+            result->layout.column_writers[col_index] = bind_data.column_writers[column_id];
+        }
+        if (result->filter_properties.empty())
+        {
+            // An empty filter_properties returns every property. Request only the title, which every
+            // database has, when no property is needed at all (e.g. for count(*)).
+            result->filter_properties.push_back("title");
+        }
+
+        // The page cache holds every page of the database, so it can't serve scans that Notion has to
+        // order, limit or restrict to recently edited pages or a filter := condition
+        bool can_cache = bind_data.row_limit == DConstants::INVALID_INDEX && bind_data.sorts.empty() &&
+                         bind_data.since_filter.is_null() && bind_data.user_filter.is_null();
+        if (can_cache)
+        {
+            result->page_cache = NotionPageCache::Open(context, bind_data, *result);
+            if (result->page_cache)
+            {
+                return std::move(result);
+            }
+        }
+
+        // A pushed down ORDER BY ... LIMIT relies on reading a single, sorted sequence of pages
+        bool can_partition = bind_data.partitions > 1 && bind_data.row_limit == DConstants::INVALID_INDEX &&
+                             bind_data.sorts.empty();
+        if (can_partition)
+        {
+            result->slice_filters = partition_scan(context, bind_data, *result);
+        }
+        else
+        {
+            result->slice_filters.push_back(result->query_filter);
+        }
+        return std::move(result);
+    }
+
+    unique_ptr<LocalTableFunctionState> notion_init_local(ExecutionContext &context, TableFunctionInitInput &input,
+                                                          GlobalTableFunctionState *global_state)
+    {
+        return make_uniq<NotionReadLocalState>();
+    }
+
+    // Remembers the page count of the database once a scan has read all of it, for the cardinality
+    // estimate and the progress of later scans
+    static void store_row_count(ClientContext &context, const NotionReadFunctionData &bind_data,
+                                const NotionReadGlobalState &gstate)
+    {
+        NotionSchemaCache::Get(context)->StoreRowCount(gstate.token, bind_data.database_id, gstate.rows_fetched);
+    }
+
+    // Decodes pages into the chunk until the next page might not fit or the thread has run out of slices
+    static void fill_chunk(ClientContext &context, const NotionReadFunctionData &bind_data, NotionReadGlobalState &gstate,
+                           NotionReadLocalState &lstate, DataChunk &output)
+    {
+        // Each response is decoded straight into the chunk, so a page is only requested while a full page
+        // still fits. Nothing but the response being decoded is held in memory.
         idx_t row_index = 0;
+        while (row_index + NOTION_MAX_PAGE_SIZE <= STANDARD_VECTOR_SIZE)
+        {
+            if (lstate.cursor)
+            {
+                if (fetch_next_page(context, bind_data, gstate, *lstate.cursor, output, row_index))
+                {
+                    continue;
+                }
+                // Only a query without conditions or a limit reads every page
+                bool whole_database = gstate.query_filter.is_null() && bind_data.row_limit == DConstants::INVALID_INDEX;
+                if (++gstate.slices_finished == gstate.slice_filters.size() && whole_database)
+                {
+                    store_row_count(context, bind_data, gstate);
+                }
+            }
+
+            // Take the next unclaimed slice
+            auto slice_index = gstate.next_slice++;
+            if (slice_index >= gstate.slice_filters.size())
+            {
+                lstate.cursor.reset();
+                break;
+            }
+            lstate.cursor = make_uniq<NotionScanCursor>();
+            lstate.cursor->filter = gstate.slice_filters[slice_index];
+            // A limited scan sizes its requests by the rows still missing, so it requests pages on demand
+            if (gstate.prefetch_pages > 0 && bind_data.row_limit == DConstants::INVALID_INDEX)
+            {
+                lstate.cursor->prefetcher = make_uniq<NotionPagePrefetcher>(
+                    context, gstate.api, bind_data.database_id, query_request(bind_data, lstate.cursor->filter),
+                    gstate.filter_properties, gstate.prefetch_pages, gstate.metrics);
+            }
+        }
 
-        for (const auto &page : results)
+        auto first_row_id = gstate.rows_emitted.fetch_add(row_index);
+        for (idx_t col_index = 0; col_index < gstate.column_ids.size(); col_index++)
         {
-            if (!page.contains("properties"))
+            if (gstate.column_ids[col_index] != COLUMN_IDENTIFIER_ROW_ID)
             {
                 continue;
             }
+            auto row_ids = FlatVector::GetData<int64_t>(output.data[col_index]);
+            for (idx_t i = 0; i < row_index; i++)
+            {
+                row_ids[i] = first_row_id + i;
+            }
+        }
+        output.SetCardinality(row_index);
+    }
+
+    void notion_read_function(ClientContext &context, TableFunctionInput &data_p, DataChunk &output)
+    {
+        auto &bind_data = data_p.bind_data->Cast<NotionReadFunctionData>();
+        auto &gstate = data_p.global_state->Cast<NotionReadGlobalState>();
+        auto &lstate = data_p.local_state->Cast<NotionReadLocalState>();
+        NotionMetricsScope metrics_scope(gstate.metrics);
+
+        if (gstate.page_cache)
+        {
+            // The cache holds every page of the database
+            if (!gstate.page_cache->Scan(output))
+            {
+                store_row_count(context, bind_data, gstate);
+            }
+            gstate.rows_fetched += output.size();
+            return;
+        }
+        fill_chunk(context, bind_data, gstate, lstate, output);
+    }
+
+    // Translates the WHERE clause into a Notion filter so Notion returns fewer pages. Notion's conditions only
+    // approximate the predicates (dates are compared a day wider, text by Notion's own rules), so no filter is
+    // taken out of the plan: DuckDB still evaluates every one of them on the scanned rows.
+    static void notion_pushdown_complex_filter(ClientContext &context, LogicalGet &get, FunctionData *bind_data_p,
+                                               vector<unique_ptr<Expression>> &filters)
+    {
+        auto &bind_data = bind_data_p->Cast<NotionReadFunctionData>();
+        FilterCombiner combiner(context);
+        for (auto &filter : filters)
+        {
+            combiner.AddFilter(filter->Copy());
+        }
+        auto table_filters = combiner.GenerateTableScanFilters(get.GetColumnIds());
+        bind_data.pushed_filter = notion_filter_from_table_filters(table_filters, get.GetColumnIds(), bind_data.properties);
+    }
 
-            // Process each property/column
-            auto &properties = page["properties"];
-            idx_t col_index = 0;
+    // Notion doesn't report how many pages a database has. Without an earlier scan to go by, a single
+    // request for one page of titles gives the exact count of small databases, and a lower bound otherwise.
+    static idx_t notion_estimate_row_count(ClientContext &context, const std::string &token, const std::string &database_id,
+                                           bool &is_lower_bound)
+    {
+        auto schema_cache = NotionSchemaCache::Get(context);
+        auto row_count = schema_cache->GetRowCount(token, database_id, is_lower_bound);
+        if (row_count != DConstants::INVALID_INDEX)
+        {
+            return row_count;
+        }
 
-            for (const auto &property : properties.items())
+        NotionApiContext api(context, token);
+        json request_body = {{"page_size", NOTION_MAX_PAGE_SIZE}};
+        auto response = parse_json(query_database(context, api, database_id, request_body.dump(), {"title"}));
+        if (!response.contains("results") || !response["results"].is_array())
+        {
+            throw IOException("Invalid response from Notion API: no results found");
+        }
+        row_count = response["results"].size();
+        is_lower_bound = response.value("has_more", false);
+        schema_cache->StoreRowCount(token, database_id, row_count, is_lower_bound);
+        return row_count;
+    }
+
+    static unique_ptr<NodeStatistics> notion_cardinality(ClientContext &context, const FunctionData *bind_data_p)
+    {
+        auto &bind_data = bind_data_p->Cast<NotionReadFunctionData>();
+        bool is_lower_bound;
+        auto row_count = notion_estimate_row_count(context, bind_data.token, bind_data.database_id, is_lower_bound);
+        if (is_lower_bound)
+        {
+            // More pages than a probe returns: assume a large database until a full scan has counted it
+            row_count = MaxValue<idx_t>(row_count, NOTION_UNCOUNTED_ROW_ESTIMATE);
+        }
+        if (bind_data.row_limit != DConstants::INVALID_INDEX)
+        {
+            return make_uniq<NodeStatistics>(MinValue<idx_t>(row_count, bind_data.row_limit), bind_data.row_limit);
+        }
+        return make_uniq<NodeStatistics>(row_count);
+    }
+
+    // Describes the scan in EXPLAIN. The traffic of a scan is reported by notion_metrics(last_scan := true), as
+    // the extra info of an operator is captured before the query runs.
+    static string notion_read_to_string(const FunctionData *bind_data_p)
+    {
+        auto &bind_data = bind_data_p->Cast<NotionReadFunctionData>();
+        std::string result = "Database: " + bind_data.database_id;
+        if (!bind_data.sorts.empty())
+        {
+            result += "\nSorts: " + bind_data.sorts.dump();
+        }
+        if (bind_data.row_limit != DConstants::INVALID_INDEX)
+        {
+            result += "\nLimit: " + std::to_string(bind_data.row_limit);
+        }
+        if (bind_data.partitions > 1)
+        {
+            result += "\nPartitions: " + std::to_string(bind_data.partitions);
+        }
+        return result;
+    }
+
+    // Reports the pages read against the page count of the last complete scan. Notion evaluates pushed down
+    // conditions before returning pages, so a filtered scan may finish well short of 100%.
+    static double notion_scan_progress(ClientContext &context, const FunctionData *bind_data_p,
+                                       const GlobalTableFunctionState *global_state)
+    {
+        auto &gstate = global_state->Cast<NotionReadGlobalState>();
+        if (gstate.estimated_rows == DConstants::INVALID_INDEX || gstate.estimated_rows == 0)
+        {
+            return -1;
+        }
+        return MinValue<double>(100.0 * double(gstate.rows_fetched) / double(gstate.estimated_rows), 100.0);
+    }
+
+    unique_ptr<NotionReadFunctionData> notion_bind_database(ClientContext &context, const std::string &database_id,
+                                                            const named_parameter_map_t &options,
+                                                            vector<LogicalType> &return_types, vector<string> &names)
+    {
+        // Several integrations can be used side by side through named secrets, each with its own rate limit
+        std::string secret_name;
+        for (auto &kv : options)
+        {
+            if (StringUtil::Lower(kv.first) == "secret" && !kv.second.IsNull())
             {
-                const auto &prop_value = property.value();
-                const auto &prop_type = prop_value["type"].get<std::string>();
+                secret_name = StringValue::Get(kv.second);
+            }
+        }
+        NotionApiContext api(context, get_notion_token(context, secret_name));
 
-                // Extract value based on property type
-                if (prop_type == "title" || prop_type == "rich_text")
+        // Get the database schema, cached across statements
+        auto database_metadata = NotionSchemaCache::Get(context)->GetDatabase(context, api, database_id);
+        if (!database_metadata->contains("properties"))
+        {
+            throw IOException("Invalid response from Notion API: database %s has no properties", database_id);
+        }
+        auto &properties = (*database_metadata)["properties"];
+        auto bind_data = make_uniq<NotionReadFunctionData>(database_id);
+        bind_data->token = api.token;
+        std::string partition_by;
+        bool page_metadata = false;
+        bool date_ranges = false;
+        for (auto &kv : options)
+        {
+            auto loption = StringUtil::Lower(kv.first);
+            if (loption == "partitions")
+            {
+                auto partitions = kv.second.GetValue<int64_t>();
+                if (partitions < 1)
                 {
-                    auto &text_array = prop_value[prop_type];
-                    std::string text = text_array.empty() ? "" : text_array[0]["plain_text"].get<std::string>();
-                    output.SetValue(col_index, row_index, Value(text));
+                    throw BinderException("read_notion: partitions must be at least 1");
                 }
-                else if (prop_type == "number")
+                bind_data->partitions = partitions;
+            }
+            else if (loption == "partition_by")
+            {
+                partition_by = kv.second.GetValue<string>();
+            }
+            else if (loption == "page_metadata")
+            {
+                page_metadata = BooleanValue::Get(kv.second);
+            }
+            else if (loption == "date_ranges")
+            {
+                date_ranges = BooleanValue::Get(kv.second);
+            }
+            else if (loption == "since")
+            {
+                if (kv.second.IsNull())
                 {
-                    if (prop_value["number"].is_null())
-                    {
-                        output.SetValue(col_index, row_index, Value());
-                    }
-                    else
-                    {
-                        double number = prop_value["number"].get<double>();
-                        output.SetValue(col_index, row_index, Value(number));
-                    }
+                    continue;
                 }
-                else if (prop_type == "date")
+                auto since = TimestampValue::Get(kv.second);
+                if (!Timestamp::IsFinite(since))
                 {
-                    if (prop_value["date"].is_null())
-                    {
-                        output.SetValue(col_index, row_index, Value());
-                    }
-                    else
-                    {
-                        std::string date = prop_value["date"]["start"].get<std::string>();
-                        output.SetValue(col_index, row_index, Value::TIMESTAMP(Timestamp::FromString(date)));
-                    }
+                    continue;
                 }
-                else if (prop_type == "multi_select")
+                bind_data->since_filter = notion_last_edited_since_filter(since);
+            }
+            else if (loption == "filter")
+            {
+                // A filter object as in the Notion query API, e.g. the conditions of a database view
+                if (kv.second.IsNull())
+                {
+                    continue;
+                }
+                try
+                {
+                    bind_data->user_filter = json::parse(StringValue::Get(kv.second));
+                }
+                catch (const json::exception &e)
                 {
-                    auto tags = prop_value["multi_select"];
-                    std::string tag_list;
-                    for (size_t i = 0; i < tags.size(); i++)
-                    {
-                        if (i > 0)
-                            tag_list += ", ";
-                        tag_list += tags[i]["name"].get<std::string>();
-                    }
-                    output.SetValue(col_index, row_index, Value(tag_list));
+                    throw BinderException("read_notion: filter is not valid JSON: %s", e.what());
                 }
-                else
+                if (!bind_data->user_filter.is_object())
                 {
-                    // Default to empty string for unsupported types
-                    output.SetValue(col_index, row_index, Value());
+                    throw BinderException("read_notion: filter must be a JSON object");
                 }
+            }
+        }
+
+        for (const auto &property : properties.items())
+        {
+            std::string name = property.key();
+            std::string type = property.value()["type"];
+
+            NotionProperty column;
+            column.id = property.value()["id"].get<std::string>();
+            column.name = name;
+            column.type = parse_notion_property_type(type);
+            names.push_back(name);
+            if (date_ranges && column.type == NotionPropertyType::DATE)
+            {
+                bind_data->column_writers.push_back(get_notion_date_range_writer());
+                return_types.push_back(notion_date_range_type());
+            }
+            else
+            {
+                bind_data->column_writers.push_back(get_notion_column_writer(column.type));
+                return_types.push_back(notion_type_to_duckdb_type(property.value()));
+            }
+            bind_data->properties.push_back(std::move(column));
+        }
+
+        if (page_metadata)
+        {
+            NotionProperty page_id;
+            page_id.id = "id";
+            page_id.name = NOTION_PAGE_ID_COLUMN;
+            page_id.type = NotionPropertyType::UNKNOWN;
+            page_id.page_field = true;
+            bind_data->column_writers.push_back(get_notion_page_id_writer());
+            bind_data->properties.push_back(std::move(page_id));
+            names.push_back(NOTION_PAGE_ID_COLUMN);
+            return_types.push_back(LogicalType::VARCHAR);
 
-                col_index++;
+            NotionProperty last_edited_time;
+            last_edited_time.id = "last_edited_time";
+            last_edited_time.name = NOTION_LAST_EDITED_TIME_COLUMN;
+            last_edited_time.type = NotionPropertyType::LAST_EDITED_TIME;
+            last_edited_time.page_field = true;
+            bind_data->column_writers.push_back(get_notion_column_writer(NotionPropertyType::LAST_EDITED_TIME));
+            bind_data->properties.push_back(std::move(last_edited_time));
+            names.push_back(NOTION_LAST_EDITED_TIME_COLUMN);
+            return_types.push_back(LogicalType::TIMESTAMP);
+        }
+
+        if (!partition_by.empty())
+        {
+            for (idx_t i = 0; i < bind_data->properties.size(); i++)
+            {
+                if (!bind_data->properties[i].page_field && bind_data->properties[i].name == partition_by)
+                {
+                    bind_data->partition_property = i;
+                }
+            }
+            if (bind_data->partition_property == DConstants::INVALID_INDEX)
+            {
+                throw BinderException("read_notion: partition_by property \"%s\" does not exist", partition_by);
+            }
+            auto partition_type = bind_data->properties[bind_data->partition_property].type;
+            if (partition_type != NotionPropertyType::DATE && partition_type != NotionPropertyType::CREATED_TIME)
+            {
+                throw BinderException("read_notion: partition_by property \"%s\" must be a date or created_time property",
+                                      partition_by);
             }
-            row_index++;
         }
 
-        output.SetCardinality(row_index);
+        bind_data->types = return_types;
+        return bind_data;
     }
 
     unique_ptr<FunctionData> notion_bind_function(ClientContext &context, TableFunctionBindInput &input,
                                                   vector<LogicalType> &return_types, vector<string> &names)
     {
-        auto database_input = input.inputs[0].GetValue<string>();
-        std::string database_id = extract_database_id(database_input);
-        std::string token = get_notion_token(context);
+        auto database_id = extract_database_id(input.inputs[0].GetValue<string>());
+        return notion_bind_database(context, database_id, input.named_parameters, return_types, names);
+    }
 
-        // Get the database schema
-        std::string database_metadata = get_database(token, database_id);
-        auto database_metadata_json = parse_json(database_metadata);
-        auto properties = database_metadata_json["properties"];
-        for (const auto &property : properties.items())
-        {
-            std::string name = property.key();
-            std::string type = property.value()["type"];
+    TableFunction notion_read_table_function()
+    {
+        TableFunction function("read_notion", {LogicalType::VARCHAR}, notion_read_function, notion_bind_function,
+                               notion_init_global, notion_init_local);
+        function.named_parameters["partitions"] = LogicalType::BIGINT;
+        function.named_parameters["partition_by"] = LogicalType::VARCHAR;
+        function.named_parameters["page_metadata"] = LogicalType::BOOLEAN;
+        function.named_parameters["date_ranges"] = LogicalType::BOOLEAN;
+        function.named_parameters["since"] = LogicalType::TIMESTAMP;
+        function.named_parameters["filter"] = LogicalType::VARCHAR;
+        function.named_parameters["secret"] = LogicalType::VARCHAR;
+        function.to_string = notion_read_to_string;
+        function.cardinality = notion_cardinality;
+        function.table_scan_progress = notion_scan_progress;
+        function.projection_pushdown = true;
+        function.pushdown_complex_filter = notion_pushdown_complex_filter;
+        return function;
+    }
 
-            names.push_back(name);
-            return_types.push_back(notion_type_to_duckdb_type(type));
+    unique_ptr<TableRef> notion_replacement_scan(ClientContext &context, ReplacementScanInput &input,
+                                                 optional_ptr<ReplacementScanData> data)
+    {
+        auto table_name = ReplacementScan::GetFullPath(input);
+        if (!StringUtil::Contains(table_name, "notion.so/") && !StringUtil::Contains(table_name, "notion.site/"))
+        {
+            return nullptr;
+        }
+        try
+        {
+            extract_database_id(table_name);
+        }
+        catch (InvalidInputException &)
+        {
+            return nullptr;
         }
 
-        // Create the bind data
-        auto bind_data = make_uniq<NotionReadFunctionData>(database_id);
-        return bind_data;
+        // The ?v= of a view link is dropped: the public API doesn't expose views, so their filters and sorts
+        // can't be fetched. Conditions in the WHERE clause, or filter := '...', are evaluated by Notion instead.
+        auto table_function = make_uniq<TableFunctionRef>();
+        vector<unique_ptr<ParsedExpression>> children;
+        children.push_back(make_uniq<ConstantExpression>(Value(table_name)));
+        table_function->function = make_uniq<FunctionExpression>("read_notion", std::move(children));
+        return std::move(table_function);
     }
 } // namespace duckdb
@@ -0,0 +1,359 @@
+#include "notion_related.hpp"
+#include "notion_auth.hpp"
+#include "notion_read.hpp"
+#include "notion_requests.hpp"
+#include "notion_request_dispatcher.hpp"
+#include "notion_schema_cache.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/string_util.hpp"
+#include <functional>
+#include <unordered_set>
+
+namespace duckdb
+{
+
+    //! The number of related pages requested before their responses are parsed, which bounds the
+    //! memory held by raw responses
+    static constexpr idx_t RELATED_PAGE_BATCH_SIZE = 1000;
+
+    shared_ptr<NotionPageLRU> NotionPageLRU::Get(ClientContext &context)
+    {
+        auto &cache = ObjectCache::GetObjectCache(context);
+        return cache.GetOrCreate<NotionPageLRU>(ObjectType());
+    }
+
+    std::string NotionPageLRU::Key(const std::string &token, const std::string &page_id)
+    {
+        // Key on a hash so the token itself isn't kept around in the cache
+        return page_id + ":" + std::to_string(std::hash<std::string>()(token));
+    }
+
+    shared_ptr<const json> NotionPageLRU::Lookup(const std::string &token, const std::string &page_id,
+                                                 std::chrono::seconds max_age)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto entry = index.find(Key(token, page_id));
+        if (entry == index.end())
+        {
+            return nullptr;
+        }
+        if (std::chrono::steady_clock::now() - entry->second->fetched_at >= max_age)
+        {
+            entries.erase(entry->second);
+            index.erase(entry);
+            return nullptr;
+        }
+        entries.splice(entries.begin(), entries, entry->second);
+        return entry->second->page;
+    }
+
+    void NotionPageLRU::Insert(const std::string &token, const std::string &page_id, shared_ptr<const json> page,
+                               idx_t capacity)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto key = Key(token, page_id);
+        auto entry = index.find(key);
+        if (entry != index.end())
+        {
+            entries.erase(entry->second);
+            index.erase(entry);
+        }
+        entries.push_front({key, std::move(page), std::chrono::steady_clock::now()});
+        index[key] = entries.begin();
+        while (entries.size() > capacity)
+        {
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+    }
+
+    void NotionPageLRU::Clear()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        entries.clear();
+        index.clear();
+    }
+
+    struct NotionRelatedGlobalState : public GlobalTableFunctionState
+    {
+        //! The token, settings and pools of the scan, shared by the threads fetching pages
+        shared_ptr<NotionApiContext> api;
+        vector<column_t> column_ids;
+        //! Every edge of the relation, as the ids of the page and the related page
+        vector<std::pair<std::string, std::string>> edges;
+        //! The related pages by id, only fetched when one of their properties is projected
+        std::unordered_map<std::string, shared_ptr<const json>> pages;
+        //! The next edge to output
+        idx_t position = 0;
+    };
+
+    static unique_ptr<FunctionData> notion_related_bind(ClientContext &context, TableFunctionBindInput &input,
+                                                        vector<LogicalType> &return_types, vector<string> &names)
+    {
+        auto result = make_uniq<NotionRelatedFunctionData>();
+        result->database_id = extract_database_id(input.inputs[0].GetValue<string>());
+        auto relation_name = input.inputs[1].GetValue<string>();
+        std::string secret_name;
+        for (auto &kv : input.named_parameters)
+        {
+            if (StringUtil::Lower(kv.first) == "concurrency")
+            {
+                auto concurrency = kv.second.GetValue<int64_t>();
+                if (concurrency < 1)
+                {
+                    throw BinderException("read_notion_related: concurrency must be at least 1");
+                }
+                result->concurrency = concurrency;
+            }
+            else if (StringUtil::Lower(kv.first) == "secret" && !kv.second.IsNull())
+            {
+                secret_name = StringValue::Get(kv.second);
+            }
+        }
+
+        result->token = get_notion_token(context, secret_name);
+        NotionApiContext api(context, result->token);
+        auto &schema_cache = *NotionSchemaCache::Get(context);
+        auto database = schema_cache.GetDatabase(context, api, result->database_id);
+        if (!database->contains("properties"))
+        {
+            throw IOException("Invalid response from Notion API: database %s has no properties", result->database_id);
+        }
+        auto relation = find_notion_property((*database)["properties"], relation_name);
+        if (!relation || (*relation)["type"] != "relation")
+        {
+            throw BinderException("read_notion_related: \"%s\" is not a relation property of the database", relation_name);
+        }
+        result->relation_name = (*relation)["name"].get<std::string>();
+        result->relation_id = (*relation)["id"].get<std::string>();
+        result->related_database_id = (*relation)["relation"]["database_id"].get<std::string>();
+
+        auto related_database = schema_cache.GetDatabase(context, api, result->related_database_id);
+        if (!related_database->contains("properties"))
+        {
+            throw IOException("Invalid response from Notion API: database %s has no properties", result->related_database_id);
+        }
+
+        names = {NOTION_PAGE_ID_COLUMN, NOTION_RELATED_PAGE_ID_COLUMN};
+        return_types = {LogicalType::VARCHAR, LogicalType::VARCHAR};
+        for (const auto &property : (*related_database)["properties"].items())
+        {
+            std::string type = property.value()["type"];
+            result->property_names.push_back(property.key());
+            result->column_writers.push_back(get_notion_column_writer(parse_notion_property_type(type)));
+            names.push_back(property.key());
+            return_types.push_back(notion_type_to_duckdb_type(property.value()));
+        }
+        return std::move(result);
+    }
+
+    // Reads the relation of every page with an id-only scan. Page objects hold at most 25 entries of a
+    // relation, the ids of pages with more are returned so their relation can be paginated separately.
+    static vector<std::string> scan_relation(ClientContext &context, const NotionRelatedFunctionData &bind_data,
+                                             NotionRelatedGlobalState &gstate)
+    {
+        vector<std::string> truncated;
+        std::string next_cursor;
+        do
+        {
+            json request_body = {{"page_size", NOTION_MAX_PAGE_SIZE}};
+            if (!next_cursor.empty())
+            {
+                request_body["start_cursor"] = next_cursor;
+            }
+            auto response = parse_json(query_database(context, *gstate.api, bind_data.database_id, request_body.dump(),
+                                                      {bind_data.relation_id}));
+            if (!response.contains("results"))
+            {
+                throw IOException("Invalid response from Notion API: no results found");
+            }
+            for (auto &page : response["results"])
+            {
+                auto page_id = page["id"].get<std::string>();
+                auto &relation = page["properties"][bind_data.relation_name];
+                if (relation.value("has_more", false))
+                {
+                    truncated.push_back(std::move(page_id));
+                    continue;
+                }
+                for (auto &related : relation["relation"])
+                {
+                    gstate.edges.emplace_back(page_id, related["id"].get<std::string>());
+                }
+            }
+            next_cursor = response.value("has_more", false) ? response["next_cursor"].get<std::string>() : "";
+        } while (!next_cursor.empty());
+        return truncated;
+    }
+
+    // Paginates the relation of the pages through GET /v1/pages/{id}/properties/{property}. The pages are walked
+    // side by side, one request per page in flight.
+    static void paginate_relations(ClientContext &context, const NotionRelatedFunctionData &bind_data, vector<std::string> page_ids, NotionRelatedGlobalState &gstate)
+    {
+        vector<std::string> cursors(page_ids.size());
+        while (!page_ids.empty())
+        {
+            vector<std::string> paths;
+            for (idx_t i = 0; i < page_ids.size(); i++)
+            {
+                auto path = "/v1/pages/" + page_ids[i] + "/properties/" + bind_data.relation_id + "?page_size=" +
+                            std::to_string(NOTION_MAX_PAGE_SIZE);
+                if (!cursors[i].empty())
+                {
+                    path += "&start_cursor=" + url_encode(cursors[i]);
+                }
+                paths.push_back(std::move(path));
+            }
+            auto responses = notion_get_concurrently(context, *gstate.api, paths, bind_data.concurrency);
+
+            vector<std::string> next_page_ids;
+            vector<std::string> next_cursors;
+            for (idx_t i = 0; i < responses.size(); i++)
+            {
+                auto response = parse_json(responses[i]);
+                for (auto &item : response["results"])
+                {
+                    gstate.edges.emplace_back(page_ids[i], item["relation"]["id"].get<std::string>());
+                }
+                if (response.value("has_more", false))
+                {
+                    next_page_ids.push_back(page_ids[i]);
+                    next_cursors.push_back(response["next_cursor"].get<std::string>());
+                }
+            }
+            page_ids = std::move(next_page_ids);
+            cursors = std::move(next_cursors);
+        }
+    }
+
+    // Looks up every distinct related page, from the cache where possible
+    static void fetch_related_pages(ClientContext &context, const NotionRelatedFunctionData &bind_data,
+                                    NotionRelatedGlobalState &gstate)
+    {
+        idx_t capacity = NOTION_DEFAULT_RELATED_PAGE_CACHE_SIZE;
+        Value capacity_value;
+        if (context.TryGetCurrentSetting("notion_related_page_cache_size", capacity_value) && !capacity_value.IsNull())
+        {
+            capacity = capacity_value.GetValue<int64_t>();
+        }
+        int64_t ttl_seconds = NOTION_DEFAULT_RELATED_PAGE_CACHE_TTL_SECONDS;
+        Value ttl_value;
+        if (context.TryGetCurrentSetting("notion_related_page_cache_ttl", ttl_value) && !ttl_value.IsNull())
+        {
+            ttl_seconds = ttl_value.GetValue<int64_t>();
+        }
+
+        auto &cache = *NotionPageLRU::Get(context);
+        vector<std::string> missing;
+        for (auto &edge : gstate.edges)
+        {
+            if (gstate.pages.count(edge.second))
+            {
+                continue;
+            }
+            auto page = cache.Lookup(bind_data.token, edge.second, std::chrono::seconds(ttl_seconds));
+            if (!page)
+            {
+                missing.push_back(edge.second);
+            }
+            gstate.pages[edge.second] = std::move(page);
+        }
+
+        for (idx_t batch_start = 0; batch_start < missing.size(); batch_start += RELATED_PAGE_BATCH_SIZE)
+        {
+            auto batch_end = MinValue<idx_t>(batch_start + RELATED_PAGE_BATCH_SIZE, missing.size());
+            vector<std::string> paths;
+            for (idx_t i = batch_start; i < batch_end; i++)
+            {
+                paths.push_back("/v1/pages/" + missing[i]);
+            }
+            // A related page that was deleted or isn't shared with the integration has NULL properties
+            auto responses = notion_get_concurrently(context, *gstate.api, paths, bind_data.concurrency, true);
+            for (idx_t i = batch_start; i < batch_end; i++)
+            {
+                if (responses[i - batch_start].empty())
+                {
+                    continue;
+                }
+                auto page = make_shared_ptr<const json>(parse_json(responses[i - batch_start]));
+                if (ttl_seconds > 0 && capacity > 0)
+                {
+                    cache.Insert(bind_data.token, missing[i], page, capacity);
+                }
+                gstate.pages[missing[i]] = std::move(page);
+            }
+        }
+    }
+
+    static unique_ptr<GlobalTableFunctionState> notion_related_init_global(ClientContext &context, TableFunctionInitInput &input)
+    {
+        auto &bind_data = input.bind_data->Cast<NotionRelatedFunctionData>();
+        auto result = make_uniq<NotionRelatedGlobalState>();
+        result->api = make_shared_ptr<NotionApiContext>(context, bind_data.token);
+        result->column_ids = input.column_ids;
+
+        auto truncated = scan_relation(context, bind_data, *result);
+        paginate_relations(context, bind_data, std::move(truncated), *result);
+
+        // The related pages are only looked up when one of their properties is projected
+        for (auto column_id : result->column_ids)
+        {
+            if (column_id != COLUMN_IDENTIFIER_ROW_ID && column_id >= 2)
+            {
+                fetch_related_pages(context, bind_data, *result);
+                break;
+            }
+        }
+        return std::move(result);
+    }
+
+    static void notion_related_function(ClientContext &context, TableFunctionInput &data_p, DataChunk &output)
+    {
+        auto &bind_data = data_p.bind_data->Cast<NotionRelatedFunctionData>();
+        auto &gstate = data_p.global_state->Cast<NotionRelatedGlobalState>();
+
+        idx_t count = MinValue<idx_t>(STANDARD_VECTOR_SIZE, gstate.edges.size() - gstate.position);
+        for (idx_t row_index = 0; row_index < count; row_index++)
+        {
+            auto &edge = gstate.edges[gstate.position + row_index];
+            for (idx_t col_index = 0; col_index < gstate.column_ids.size(); col_index++)
+            {
+                auto column_id = gstate.column_ids[col_index];
+                auto &result = output.data[col_index];
+                if (column_id == COLUMN_IDENTIFIER_ROW_ID)
+                {
+                    FlatVector::GetData<int64_t>(result)[row_index] = gstate.position + row_index;
+                }
+                else if (column_id < 2)
+                {
+                    auto &id = column_id == 0 ? edge.first : edge.second;
+                    FlatVector::GetData<string_t>(result)[row_index] = StringVector::AddString(result, id);
+                }
+                else
+                {
+                    auto &page = gstate.pages[edge.second];
+                    auto &name = bind_data.property_names[column_id - 2];
+                    if (!page || !page->contains("properties") || !(*page)["properties"].contains(name))
+                    {
+                        FlatVector::SetNull(result, row_index, true);
+                        continue;
+                    }
+                    bind_data.column_writers[column_id - 2]((*page)["properties"][name], result, row_index);
+                }
+            }
+        }
+        gstate.position += count;
+        output.SetCardinality(count);
+    }
+
+    TableFunction notion_read_related_table_function()
+    {
+        TableFunction function("read_notion_related", {LogicalType::VARCHAR, LogicalType::VARCHAR}, notion_related_function,
+                               notion_related_bind, notion_related_init_global);
+        function.named_parameters["concurrency"] = LogicalType::BIGINT;
+        function.named_parameters["secret"] = LogicalType::VARCHAR;
+        function.projection_pushdown = true;
+        return function;
+    }
+
+} // namespace duckdb
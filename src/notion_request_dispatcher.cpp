@@ -0,0 +1,196 @@
+#include "notion_request_dispatcher.hpp"
+#include "duckdb/common/error_data.hpp"
+#include "duckdb/common/exception.hpp"
+#include <algorithm>
+#include <atomic>
+
+namespace duckdb
+{
+
+    NotionRequestDispatcher::NotionRequestDispatcher(ClientContext &context, shared_ptr<NotionApiContext> api_p, idx_t concurrency)
+        : context(context), api(make_shared_ptr<NotionApiContext>(*api_p)), max_queued(concurrency * 2)
+    {
+        // The copy shares the pools and the rate limiter, only the cancellation flag is the dispatcher's own
+        api->cancelled = &cancelled;
+        for (idx_t i = 0; i < concurrency; i++)
+        {
+            workers.emplace_back([this]()
+                                 { Work(); });
+        }
+    }
+
+    NotionRequestDispatcher::~NotionRequestDispatcher()
+    {
+        Stop();
+    }
+
+    void NotionRequestDispatcher::Stop()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopped = true;
+            queue.clear();
+        }
+        // Requests in flight give up their retry and rate limiter waits
+        cancelled = true;
+        request_available.notify_all();
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        workers.clear();
+    }
+
+    void NotionRequestDispatcher::Work()
+    {
+        while (true)
+        {
+            NotionPendingRequest request;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                request_available.wait(guard, [&]()
+                                       { return stopped || !queue.empty(); });
+                if (queue.empty())
+                {
+                    return;
+                }
+                request = std::move(queue.front());
+                queue.pop_front();
+                in_flight++;
+            }
+            request_done.notify_all();
+
+            std::string error;
+            try
+            {
+                call_notion_api(context, *api, request.method, request.path, request.body);
+            }
+            catch (std::exception &ex)
+            {
+                error = ErrorData(ex).RawMessage();
+            }
+
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                in_flight--;
+                if (error.empty())
+                {
+                    succeeded++;
+                }
+                else
+                {
+                    errors.push_back({request.row, std::move(error)});
+                }
+            }
+            request_done.notify_all();
+        }
+    }
+
+    void NotionRequestDispatcher::Submit(NotionPendingRequest request)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        // Wake up periodically to notice an interrupted query while all workers are busy
+        while (!request_done.wait_for(guard, std::chrono::milliseconds(100), [&]()
+                                      { return queue.size() < max_queued; }))
+        {
+            if (context.interrupted)
+            {
+                throw InterruptException();
+            }
+        }
+        queue.push_back(std::move(request));
+        guard.unlock();
+        request_available.notify_one();
+    }
+
+    void NotionRequestDispatcher::Fail(idx_t row, std::string message)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        errors.push_back({row, std::move(message)});
+    }
+
+    vector<NotionRequestError> NotionRequestDispatcher::Finish()
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            while (!request_done.wait_for(guard, std::chrono::milliseconds(100), [&]()
+                                          { return queue.empty() && in_flight == 0; }))
+            {
+                if (context.interrupted)
+                {
+                    throw InterruptException();
+                }
+            }
+        }
+        Stop();
+
+        std::sort(errors.begin(), errors.end(), [](const NotionRequestError &a, const NotionRequestError &b)
+                  { return a.row < b.row; });
+        return std::move(errors);
+    }
+
+    vector<std::string> notion_get_concurrently(ClientContext &context, const NotionApiContext &api,
+                                                const vector<std::string> &paths, idx_t concurrency,
+                                                bool missing_as_empty)
+    {
+        vector<std::string> responses(paths.size());
+        std::atomic<idx_t> next_path(0);
+        std::atomic<bool> failed(false);
+        std::mutex error_lock;
+        ErrorData error;
+
+        auto work = [&]()
+        {
+            while (!failed)
+            {
+                auto path_index = next_path++;
+                if (path_index >= paths.size())
+                {
+                    return;
+                }
+                try
+                {
+                    responses[path_index] = call_notion_api(context, api, HttpMethod::GET, paths[path_index], "");
+                }
+                catch (std::exception &ex)
+                {
+                    auto api_error = dynamic_cast<NotionApiException *>(&ex);
+                    if (missing_as_empty && api_error && (api_error->status == 404 || api_error->status == 403))
+                    {
+                        continue;
+                    }
+                    std::lock_guard<std::mutex> guard(error_lock);
+                    if (!failed)
+                    {
+                        error = ErrorData(ex);
+                        failed = true;
+                    }
+                }
+            }
+        };
+
+        vector<std::thread> workers;
+        for (idx_t i = 1; i < MinValue<idx_t>(concurrency, paths.size()); i++)
+        {
+            workers.emplace_back(work);
+        }
+        // The calling thread takes part instead of idling
+        work();
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        if (failed)
+        {
+            error.Throw();
+        }
+        return responses;
+    }
+
+    idx_t NotionRequestDispatcher::Succeeded()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return succeeded;
+    }
+
+} // namespace duckdb
@@ -1,317 +1,255 @@
 #include "notion_requests.hpp"
 #include "duckdb/common/exception.hpp"
-#include <openssl/ssl.h>
-#include <openssl/err.h>
-#include <openssl/bio.h>
+#include "duckdb/common/string_util.hpp"
 #include <json.hpp>
+#include "notion_connection_pool.hpp"
+#include "notion_metrics.hpp"
+#include "notion_rate_limiter.hpp"
 #include "notion_utils.hpp"
 #include "duckdb/common/types/value.hpp"
-#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <random>
 
 namespace duckdb
 {
-    const std::string API_HOST = "api.notion.com";
     const std::string API_VERSION = "2022-02-22";
     const std::string CONTENT_TYPE = "application/json";
 
-    std::string call_notion_api(const std::string &token,
-                                HttpMethod method, const std::string &path, const std::string &body)
+    static std::string http_method_to_string(HttpMethod method)
     {
-        std::string response;
+        switch (method)
+        {
+        case HttpMethod::GET:
+            return "GET";
+        case HttpMethod::POST:
+            return "POST";
+        case HttpMethod::PUT:
+            return "PUT";
+        case HttpMethod::PATCH:
+            return "PATCH";
+        case HttpMethod::DELETE:
+            return "DELETE";
+        }
+        throw InternalException("Unknown HTTP method");
+    }
 
-        // Initialize OpenSSL
-        SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
-        if (!ctx)
+    template <class T>
+    static T get_setting(ClientContext &context, const std::string &name, T default_value)
+    {
+        Value value;
+        if (context.TryGetCurrentSetting(name, value) && !value.IsNull())
         {
-            throw duckdb::IOException("Failed to create SSL context");
+            return value.GetValue<T>();
         }
+        return default_value;
+    }
 
-        // Set up BIO chain for SSL connection
-        BIO *bio = BIO_new_ssl_connect(ctx);
-        if (!bio)
+    // Whether sending the request twice has the same effect as sending it once. Database queries and searches
+    // are POSTs that only read, while creating a page a second time would create a duplicate.
+    static bool is_idempotent_request(HttpMethod method, const std::string &path)
+    {
+        switch (method)
+        {
+        case HttpMethod::GET:
+        case HttpMethod::PUT:
+        case HttpMethod::PATCH:
+        case HttpMethod::DELETE:
+            return true;
+        case HttpMethod::POST:
         {
-            SSL_CTX_free(ctx);
-            throw duckdb::IOException("Failed to create BIO");
+            auto endpoint = path.substr(0, path.find('?'));
+            return endpoint == "/v1/search" ||
+                   (StringUtil::StartsWith(endpoint, "/v1/databases/") && StringUtil::EndsWith(endpoint, "/query"));
         }
+        }
+        return false;
+    }
 
-        SSL *ssl;
-        BIO_get_ssl(bio, &ssl);
-        SSL_set_mode(ssl, SSL_MODE_AUTO_RETRY);
+    // A rate limited request was not processed and can always be sent again. A server error may have come
+    // after the request took effect, so it is only retried when repeating the request is harmless.
+    static bool is_retryable_status(int status, bool idempotent)
+    {
+        return status == 429 || (status >= 500 && idempotent);
+    }
 
-        // Set hostname with port
-        std::string host_with_port = API_HOST + ":443";
-        BIO_set_conn_hostname(bio, host_with_port.c_str());
+    // Returns how long to wait before retrying: the server's Retry-After when given, capped at max_delay_ms, otherwise an
+    // exponential backoff with full jitter so concurrent requests don't retry in lockstep
+    static std::chrono::milliseconds retry_delay(const NotionHttpResponse &response, idx_t attempt, int64_t base_delay_ms,
+                                                 int64_t max_delay_ms)
+    {
+        auto retry_after = response.headers.find("retry-after");
+        if (retry_after != response.headers.end())
+        {
+            char *end;
+            auto seconds = std::strtod(retry_after->second.c_str(), &end);
+            if (end != retry_after->second.c_str() && seconds >= 0)
+            {
+                // A server asking for a longer wait than max_delay_ms would stall the query for as long
+                return std::chrono::milliseconds(static_cast<int64_t>(std::min<double>(seconds * 1000, max_delay_ms)));
+            }
+        }
 
-        // Set SNI hostname
-        SSL_set_tlsext_host_name(ssl, API_HOST.c_str());
+        thread_local std::mt19937_64 random_engine(std::random_device{}());
+        auto ceiling = std::min<double>(static_cast<double>(max_delay_ms), base_delay_ms * std::pow(2.0, attempt));
+        std::uniform_real_distribution<double> jitter(0, ceiling);
+        return std::chrono::milliseconds(static_cast<int64_t>(jitter(random_engine)));
+    }
 
-        // Perform connection
-        if (BIO_do_connect(bio) <= 0 || BIO_do_handshake(bio) <= 0)
+    // Builds the error for a failed request from the Notion error object, e.g.
+    // {"object": "error", "status": 400, "code": "validation_error", "message": "..."}
+    static NotionApiException notion_api_error(const std::string &method, const std::string &path, const NotionHttpResponse &response)
+    {
+        std::string detail = response.body;
+        try
+        {
+            auto error = json::parse(response.body);
+            if (error.contains("message"))
+            {
+                detail = error.value("code", "error") + ": " + error["message"].get<std::string>();
+            }
+        }
+        catch (json::exception &)
         {
-            BIO_free_all(bio);
-            SSL_CTX_free(ctx);
-            throw duckdb::IOException("Failed to establish SSL connection: " +
-                                      std::string(ERR_error_string(ERR_get_error(), nullptr)));
         }
+        return NotionApiException(StringUtil::Format("Notion API request %s %s failed with HTTP status %d: %s", method, path,
+                                                     response.status, detail),
+                                  response.status);
+    }
 
-        // Rest of the function remains the same...
-        std::string method_str;
-        switch (method)
+    NotionApiContext::NotionApiContext(ClientContext &context, std::string token_p) : token(std::move(token_p))
+    {
+        auto host = get_setting<std::string>(context, "notion_api_host", NOTION_DEFAULT_API_HOST);
+        auto port = get_setting<int64_t>(context, "notion_api_port", NOTION_DEFAULT_API_PORT);
+        auto use_tls = get_setting<bool>(context, "notion_api_use_tls", NOTION_DEFAULT_API_USE_TLS);
+        auto verify_tls = get_setting<bool>(context, "notion_api_verify_tls", NOTION_DEFAULT_API_VERIFY_TLS);
+        if (port <= 0 || port > 65535)
         {
-        case HttpMethod::GET:
-            method_str = "GET";
-            break;
-        case HttpMethod::POST:
-            method_str = "POST";
-            break;
-        case HttpMethod::PUT:
-            method_str = "PUT";
-            break;
-        case HttpMethod::PATCH:
-            method_str = "PATCH";
-            break;
-        case HttpMethod::DELETE:
-            method_str = "DELETE";
-            break;
+            throw InvalidInputException("notion_api_port must be between 1 and 65535");
+        }
+        requests_per_second = get_setting<double>(context, "notion_requests_per_second", NOTION_DEFAULT_REQUESTS_PER_SECOND);
+        burst = MaxValue<int64_t>(get_setting<int64_t>(context, "notion_request_burst", NOTION_DEFAULT_REQUEST_BURST), 1);
+        max_retries = MaxValue<int64_t>(get_setting<int64_t>(context, "notion_max_retries", NOTION_DEFAULT_MAX_RETRIES), 0);
+        base_delay_ms = get_setting<int64_t>(context, "notion_retry_base_delay_ms", NOTION_DEFAULT_RETRY_BASE_DELAY_MS);
+        max_delay_ms = get_setting<int64_t>(context, "notion_retry_max_delay_ms", NOTION_DEFAULT_RETRY_MAX_DELAY_MS);
+        if (requests_per_second <= 0)
+        {
+            throw InvalidInputException("notion_requests_per_second must be positive");
         }
 
-        // Build request
-        std::string request = method_str + " " + path + " HTTP/1.1\r\n"; // Changed to 1.1
-        request += "Host: " + API_HOST + "\r\n";
-        request += "Authorization: Bearer " + token + "\r\n";
-        request += "Notion-Version: " + API_VERSION + "\r\n";
+        headers = "Host: " + host + (port == (use_tls ? 443 : 80) ? "" : ":" + std::to_string(port)) + "\r\n";
+        headers += "Authorization: Bearer " + token + "\r\n";
+        headers += "Notion-Version: " + API_VERSION + "\r\n";
+
+        pool = NotionConnectionPool::Get(context, host, static_cast<int>(port), use_tls, verify_tls);
+        limiter = NotionRateLimiter::Get(context, token);
+        buffers = NotionBufferPool::Get(context);
+        metrics = NotionInstanceMetrics::Get(context);
+    }
+
+    std::string call_notion_api(ClientContext &context, const NotionApiContext &api, HttpMethod method,
+                                const std::string &path, const std::string &body)
+    {
+        // Build request. Connections are kept alive and reused through the pool of this database instance.
+        auto method_string = http_method_to_string(method);
+        auto idempotent = is_idempotent_request(method, path);
+        std::string request = method_string + " " + path + " HTTP/1.1\r\n";
+        request += api.headers;
 
         if (!body.empty())
         {
             request += "Content-Type: " + CONTENT_TYPE + "\r\n";
             request += "Content-Length: " + std::to_string(body.length()) + "\r\n";
         }
-        request += "Connection: close\r\n";
+        request += "Connection: keep-alive\r\n";
         request += "\r\n";
         if (!body.empty())
         {
             request += body;
         }
 
-        // Send request
-        if (BIO_write(bio, request.c_str(), request.length()) <= 0)
-        {
-            BIO_free_all(bio);
-            SSL_CTX_free(ctx);
-            throw duckdb::IOException("Failed to write request");
-        }
-
-        // Read response
-        char buffer[4096];
-        int len;
-        while ((len = BIO_read(bio, buffer, sizeof(buffer))) > 0)
+        for (idx_t attempt = 0;; attempt++)
         {
-            response.append(buffer, len);
+            auto wait_start = std::chrono::steady_clock::now();
+            api.limiter->Acquire(context, api.requests_per_second, api.burst, api.cancelled);
+            notion_record_metric(*api.metrics, &NotionMetrics::rate_limit_wait_us, notion_elapsed_us(wait_start));
+
+            auto response = api.pool->Perform(request, idempotent, *api.buffers);
+            notion_record_metric(*api.metrics, &NotionMetrics::requests, 1);
+            notion_record_metric(*api.metrics, &NotionMetrics::retries, attempt > 0 ? 1 : 0);
+            notion_record_metric(*api.metrics, &NotionMetrics::throttled_responses, response.status == 429 ? 1 : 0);
+            notion_record_metric(*api.metrics, &NotionMetrics::bytes_received, response.body.size());
+            notion_record_metric(*api.metrics, &NotionMetrics::connections_opened, response.new_connection ? 1 : 0);
+            notion_record_metric(*api.metrics, &NotionMetrics::handshake_us, response.handshake_us);
+            notion_record_metric(*api.metrics, &NotionMetrics::time_to_first_byte_us, response.time_to_first_byte_us);
+            if (response.status >= 200 && response.status < 300)
+            {
+                return std::move(response.body);
+            }
+            if (!is_retryable_status(response.status, idempotent) || attempt >= static_cast<idx_t>(api.max_retries))
+            {
+                throw notion_api_error(method_string, path, response);
+            }
+            api.buffers->Release(std::move(response.body));
+
+            auto delay = retry_delay(response, attempt, api.base_delay_ms, api.max_delay_ms);
+            if (response.status == 429)
+            {
+                // Rate limits apply to the whole integration, so hold back every request made with this token
+                api.limiter->Pause(delay);
+            }
+            else
+            {
+                notion_interruptible_sleep(context, delay, api.cancelled);
+            }
         }
-
-        // Clean up
-        BIO_free_all(bio);
-        SSL_CTX_free(ctx);
-
-        // Extract body from response
-        size_t body_start = response.find("\r\n\r\n");
-        if (body_start != std::string::npos)
-        {
-            return response.substr(body_start + 4);
-        }
-
-        return response;
     }
 
-    std::string get_database(const std::string &token, const std::string &database_id)
+    std::string get_database(ClientContext &context, const NotionApiContext &api, const std::string &database_id)
     {
-        std::cout << "Getting database: " << database_id << std::endl;
-        std::cout << "Token: " << token << std::endl;
-
-        auto response = call_notion_api(token, HttpMethod::GET, "/v1/databases/" + database_id, "");
-        std::cout << "Response: " << response << std::endl;
-        return response;
+        return call_notion_api(context, api, HttpMethod::GET, "/v1/databases/" + database_id, "");
     }
 
-    // std::string list_databases(const std::string &token)
-    // {
-    //     nlohmann::json initial_body = {
-    //         {"filter", {{"value", "database"}, {"property", "object"}}}};
-
-    //     return collect_paginated_results([&](const std::string &cursor)
-    //                                      {
-    //         nlohmann::json request_body = initial_body;
-    //         if (!cursor.empty()) {
-    //             request_body["start_cursor"] = cursor;
-    //         }
-    //         return call_notion_api(token, HttpMethod::POST, "/v1/search", request_body.dump()); });
-    // }
-
-    // // TODO: pagination, maybe filter if needed
-    std::string query_database(const std::string &token, const std::string &database_id)
+    // Lists every database shared with the integration. The search results are full database objects,
+    // properties included, so no database has to be fetched on its own afterwards.
+    std::vector<json> list_databases(ClientContext &context, const NotionApiContext &api)
     {
-        return call_notion_api(token, HttpMethod::POST, "/v1/databases/" + database_id + "/query", "{}");
+        std::vector<json> databases;
+        std::string next_cursor;
+        do
+        {
+            json request_body = {{"filter", {{"value", "database"}, {"property", "object"}}}, {"page_size", 100}};
+            if (!next_cursor.empty())
+            {
+                request_body["start_cursor"] = next_cursor;
+            }
+            auto response = parse_json(call_notion_api(context, api, HttpMethod::POST, "/v1/search", request_body.dump()));
+            if (!response.contains("results"))
+            {
+                throw IOException("Invalid response from Notion API: no results found");
+            }
+            for (auto &database : response["results"])
+            {
+                databases.push_back(std::move(database));
+            }
+            next_cursor = response.value("has_more", false) ? response["next_cursor"].get<std::string>() : "";
+        } while (!next_cursor.empty());
+        return databases;
     }
 
-    // // TODO: update database - CRUD on database rows
-    // std::string create_page(const std::string &token, const std::string &database_id, const std::string &body)
-    // {
-    //     return call_notion_api(token, HttpMethod::POST, "/v1/databases/" + database_id + "/query", body);
-    // }
-
-    // std::string update_page_properties(const std::string &token, const std::string &page_id, const std::string &body)
-    // {
-    //     return call_notion_api(token, HttpMethod::PATCH, "/v1/pages/" + page_id, body);
-    // }
-
-    // std::string delete_page(const std::string &token, const std::string &page_id)
-    // {
-    //     return call_notion_api(token, HttpMethod::DELETE, "/v1/pages/" + page_id, "");
-    // }
-
-    // TODO: create and delete databases?
-
-    // // Add function to extract property value from Notion response
-    // Value ExtractPropertyValue(const nlohmann::json &property, NotionPropertyType type)
-    // {
-    //     switch (type)
-    //     {
-    //     case NotionPropertyType::TEXT:
-    //     {
-    //         if (property.contains("title"))
-    //         {
-    //             auto &title = property["title"];
-    //             if (!title.empty() && title.contains("plain_text"))
-    //             {
-    //                 return Value(title["plain_text"].get<std::string>());
-    //             }
-    //         }
-    //         else if (property.contains("rich_text"))
-    //         {
-    //             auto &text = property["rich_text"];
-    //             if (!text.empty() && text.contains("plain_text"))
-    //             {
-    //                 return Value(text["plain_text"].get<std::string>());
-    //             }
-    //         }
-    //         return Value();
-    //     }
-    //     case NotionPropertyType::NUMBER:
-    //         return property.contains("number") ? Value(property["number"].get<double>()) : Value();
-    //     case NotionPropertyType::DATE:
-    //     {
-    //         if (property.contains("date") && property["date"].contains("start"))
-    //         {
-    //             // Parse ISO 8601 date string
-    //             std::string date_str = property["date"]["start"].get<std::string>();
-    //             try
-    //             {
-    //                 return Value::TIMESTAMP(Timestamp::FromString(date_str));
-    //             }
-    //             catch (...)
-    //             {
-    //                 return Value();
-    //             }
-    //         }
-    //         return Value();
-    //     }
-    //     case NotionPropertyType::CHECKBOX:
-    //         return property.contains("checkbox") ? Value::BOOLEAN(property["checkbox"].get<bool>()) : Value();
-    //     // Add other property type handling...
-    //     default:
-    //         return Value();
-    //     }
-    // }
-
-    // std::vector<NotionProperty> GetDatabaseSchema(const std::string &token, const std::string &database_id)
-    // {
-    //     auto response = get_database(token, database_id);
-
-    //     nlohmann::json d;
-    //     d = nlohmann::json::parse(response);
-
-    //     if (d.contains("error") || !d.contains("properties"))
-    //     {
-    //         throw IOException("Failed to parse Notion database schema");
-    //     }
-
-    //     std::vector<NotionProperty> properties;
-    //     auto &props = d["properties"];
-
-    //     for (auto &m : props.items())
-    //     {
-    //         NotionProperty property;
-    //         property.name = m.key();
-    //         property.type = ParseNotionPropertyType(m.value()["type"].get<std::string>());
-    //         properties.push_back(property);
-    //     }
-
-    //     return properties;
-    // }
-
-    // std::vector<std::vector<Value>> QueryDatabaseRows(const std::string &token, const std::string &database_id,
-    //                                                   const std::vector<NotionProperty> &properties)
-    // {
-    //     auto response = query_database(token, database_id);
-
-    //     nlohmann::json d;
-    //     d = nlohmann::json::parse(response);
-
-    //     if (d.contains("error") || !d.contains("results"))
-    //     {
-    //         throw IOException("Failed to parse Notion database query results");
-    //     }
-
-    //     std::vector<std::vector<Value>> rows;
-    //     auto &results = d["results"];
-
-    //     for (auto &page : results)
-    //     {
-    //         std::vector<Value> row;
-    //         auto &props = page["properties"];
-
-    //         for (const auto &prop : properties)
-    //         {
-    //             if (props.contains(prop.name))
-    //             {
-    //                 row.push_back(ExtractPropertyValue(props[prop.name], prop.type));
-    //             }
-    //             else
-    //             {
-    //                 row.push_back(Value());
-    //             }
-    //         }
-
-    //         rows.push_back(std::move(row));
-    //     }
-
-    //     return rows;
-    // }
-
-    // // Update create_page to handle property types correctly
-    // std::string create_page(const std::string &token, const std::string &database_id,
-    //                         const std::vector<std::pair<NotionProperty, Value>> &properties)
-    // {
-    //     nlohmann::json d = nlohmann::json::object();
-
-    //     // Set parent database
-    //     nlohmann::json parent(nlohmann::json::object());
-    //     parent["database_id"] = database_id;
-    //     d["parent"] = parent;
-
-    //     // Add properties
-    //     nlohmann::json props(nlohmann::json::object());
-    //     for (const auto &prop : properties)
-    //     {
-    //         nlohmann::json prop_obj(nlohmann::json::object());
-    //         // Convert DuckDB Value to Notion property format based on type
-    //         // ... implement property conversion ...
-    //         props[prop.first.name] = prop_obj;
-    //     }
-    //     d["properties"] = props;
-
-    //     std::string buffer = d.dump();
-
-    //     return call_notion_api(token, HttpMethod::POST, "/v1/pages", buffer);
-    // }
+    // Fetches a single page of results. Pagination is driven by the caller through
+    // the start_cursor and page_size fields of the body.
+    // When filter_properties is not empty, only the properties with these ids are returned.
+    std::string query_database(ClientContext &context, const NotionApiContext &api, const std::string &database_id,
+                               const std::string &body, const std::vector<std::string> &filter_properties)
+    {
+        std::string path = "/v1/databases/" + database_id + "/query";
+        for (size_t i = 0; i < filter_properties.size(); i++)
+        {
+            // Property ids are returned by the API already percent-encoded, so they are passed as-is
+            path += (i == 0 ? "?" : "&");
+            path += "filter_properties=" + filter_properties[i];
+        }
+        return call_notion_api(context, api, HttpMethod::POST, path, body);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "notion_schema_cache.hpp"
+#include "notion_requests.hpp"
+#include "notion_page_cache.hpp"
+#include "notion_related.hpp"
+#include <functional>
+
+namespace duckdb
+{
+
+    shared_ptr<NotionSchemaCache> NotionSchemaCache::Get(ClientContext &context)
+    {
+        auto &cache = ObjectCache::GetObjectCache(context);
+        return cache.GetOrCreate<NotionSchemaCache>(ObjectType());
+    }
+
+    shared_ptr<const json> NotionSchemaCache::GetDatabase(ClientContext &context, const NotionApiContext &api,
+                                                          const std::string &database_id)
+    {
+        int64_t ttl_seconds = NOTION_DEFAULT_SCHEMA_CACHE_TTL_SECONDS;
+        Value ttl_value;
+        if (context.TryGetCurrentSetting("notion_schema_cache_ttl", ttl_value) && !ttl_value.IsNull())
+        {
+            ttl_seconds = ttl_value.GetValue<int64_t>();
+        }
+
+        auto key = Key(api.token, database_id);
+        auto now = std::chrono::steady_clock::now();
+        if (ttl_seconds > 0)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto entry = entries.find(key);
+            if (entry != entries.end() && now - entry->second.validated_at < std::chrono::seconds(ttl_seconds))
+            {
+                return entry->second.database;
+            }
+        }
+
+        // Fetch without holding the lock, concurrent binds of other databases shouldn't wait for the API
+        // The fresh object always replaces the cached one: last_edited_time is rounded to the minute, so a
+        // schema change within the same minute as the previous one would go unnoticed
+        auto database = make_shared_ptr<const json>(parse_json(get_database(context, api, database_id)));
+
+        std::lock_guard<std::mutex> guard(lock);
+        auto &entry = entries[key];
+        entry.database = database;
+        entry.validated_at = now;
+        return database;
+    }
+
+    std::string NotionSchemaCache::Key(const std::string &token, const std::string &database_id)
+    {
+        // Key on a hash so the token itself isn't kept around in the cache
+        return database_id + ":" + std::to_string(std::hash<std::string>()(token));
+    }
+
+    void NotionSchemaCache::StoreDatabase(const std::string &token, const std::string &database_id,
+                                          shared_ptr<const json> database)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto &entry = entries[Key(token, database_id)];
+        entry.database = std::move(database);
+        entry.validated_at = std::chrono::steady_clock::now();
+    }
+
+    idx_t NotionSchemaCache::GetRowCount(const std::string &token, const std::string &database_id,
+                                         bool &is_lower_bound)
+    {
+        is_lower_bound = false;
+        std::lock_guard<std::mutex> guard(lock);
+        auto entry = entries.find(Key(token, database_id));
+        if (entry == entries.end() || !entry->second.database)
+        {
+            return DConstants::INVALID_INDEX;
+        }
+        is_lower_bound = entry->second.row_count_is_lower_bound;
+        return entry->second.row_count;
+    }
+
+    void NotionSchemaCache::StoreRowCount(const std::string &token, const std::string &database_id, idx_t row_count,
+                                          bool is_lower_bound)
+    {
+        // The count belongs to a cached database object, it isn't kept on its own
+        std::lock_guard<std::mutex> guard(lock);
+        auto entry = entries.find(Key(token, database_id));
+        if (entry == entries.end() || !entry->second.database)
+        {
+            return;
+        }
+        entry->second.row_count = row_count;
+        entry->second.row_count_is_lower_bound = is_lower_bound;
+    }
+
+    void NotionSchemaCache::Clear()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        entries.clear();
+    }
+
+    struct NotionClearCacheGlobalState : public GlobalTableFunctionState
+    {
+        bool finished = false;
+    };
+
+    static unique_ptr<FunctionData> notion_clear_cache_bind(ClientContext &context, TableFunctionBindInput &input,
+                                                            vector<LogicalType> &return_types, vector<string> &names)
+    {
+        names.push_back("success");
+        return_types.push_back(LogicalType::BOOLEAN);
+        return make_uniq<TableFunctionData>();
+    }
+
+    static unique_ptr<GlobalTableFunctionState> notion_clear_cache_init_global(ClientContext &context,
+                                                                               TableFunctionInitInput &input)
+    {
+        return make_uniq<NotionClearCacheGlobalState>();
+    }
+
+    static void notion_clear_cache_function(ClientContext &context, TableFunctionInput &data_p, DataChunk &output)
+    {
+        auto &gstate = data_p.global_state->Cast<NotionClearCacheGlobalState>();
+        if (gstate.finished)
+        {
+            return;
+        }
+        gstate.finished = true;
+
+        NotionSchemaCache::Get(context)->Clear();
+        NotionPageCache::Clear(context);
+        NotionPageLRU::Get(context)->Clear();
+        output.SetValue(0, 0, Value::BOOLEAN(true));
+        output.SetCardinality(1);
+    }
+
+    TableFunction notion_clear_cache_table_function()
+    {
+        return TableFunction("notion_clear_cache", {}, notion_clear_cache_function, notion_clear_cache_bind,
+                             notion_clear_cache_init_global);
+    }
+
+} // namespace duckdb
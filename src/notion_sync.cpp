@@ -0,0 +1,144 @@
+#include "notion_sync.hpp"
+#include "notion_read.hpp"
+#include "notion_utils.hpp"
+#include "duckdb/common/exception.hpp"
+#include "duckdb/common/string_util.hpp"
+#include "duckdb/main/connection.hpp"
+#include "duckdb/parser/keyword_helper.hpp"
+#include "duckdb/parser/qualified_name.hpp"
+
+namespace duckdb
+{
+
+    //! The temporary table holding the pages fetched by one sync, private to the sync's connection
+    static constexpr const char *CHANGES_TABLE = "__notion_sync_changes";
+
+    static unique_ptr<MaterializedQueryResult> run_query(Connection &con, const std::string &query)
+    {
+        auto result = con.Query(query);
+        if (result->HasError())
+        {
+            result->ThrowError();
+        }
+        return result;
+    }
+
+    static std::string quote_table_name(const std::string &name)
+    {
+        auto qualified_name = QualifiedName::Parse(name);
+        std::string result;
+        if (!qualified_name.catalog.empty())
+        {
+            result += KeywordHelper::WriteOptionallyQuoted(qualified_name.catalog) + ".";
+        }
+        if (!qualified_name.schema.empty())
+        {
+            result += KeywordHelper::WriteOptionallyQuoted(qualified_name.schema) + ".";
+        }
+        return result + KeywordHelper::WriteOptionallyQuoted(qualified_name.name);
+    }
+
+    static unique_ptr<FunctionData> notion_sync_bind(ClientContext &context, TableFunctionBindInput &input,
+                                                     vector<LogicalType> &return_types, vector<string> &names)
+    {
+        auto result = make_uniq<NotionSyncFunctionData>();
+        result->database_id = extract_database_id(input.inputs[0].GetValue<string>());
+        result->table_name = quote_table_name(input.inputs[1].GetValue<string>());
+        for (auto &kv : input.named_parameters)
+        {
+            if (StringUtil::Lower(kv.first) == "detect_deletes")
+            {
+                result->detect_deletes = BooleanValue::Get(kv.second);
+            }
+        }
+
+        names = {"inserted", "updated", "deleted", "watermark"};
+        return_types = {LogicalType::BIGINT, LogicalType::BIGINT, LogicalType::BIGINT, LogicalType::TIMESTAMP};
+        return std::move(result);
+    }
+
+    static unique_ptr<GlobalTableFunctionState> notion_sync_init_global(ClientContext &context, TableFunctionInitInput &input)
+    {
+        return make_uniq<NotionSyncGlobalState>();
+    }
+
+    static void notion_sync_function(ClientContext &context, TableFunctionInput &data_p, DataChunk &output)
+    {
+        auto &bind_data = data_p.bind_data->Cast<NotionSyncFunctionData>();
+        auto &gstate = data_p.global_state->Cast<NotionSyncGlobalState>();
+        if (gstate.finished)
+        {
+            return;
+        }
+        gstate.finished = true;
+
+        auto &table = bind_data.table_name;
+        auto scan = "read_notion(" + KeywordHelper::WriteQuoted(bind_data.database_id) + ", page_metadata := true";
+        auto page_id = std::string(NOTION_PAGE_ID_COLUMN);
+        auto last_edited_time = std::string(NOTION_LAST_EDITED_TIME_COLUMN);
+
+        // The merge runs in its own transaction on a separate connection so it either applies fully or not at all
+        Connection con(*context.db);
+        // The page cache keeps archived pages for up to notion_page_cache_max_age, a sync has to see what Notion
+        // returns now. The setting only applies to this connection's session.
+        run_query(con, "SET notion_page_cache_directory = ''");
+        con.BeginTransaction();
+        try
+        {
+            // Only binds the scan, LIMIT 0 stops it before any page is requested
+            run_query(con, "CREATE TABLE IF NOT EXISTS " + table + " AS SELECT * FROM " + scan + ") LIMIT 0");
+
+            auto watermark = run_query(con, "SELECT max(" + last_edited_time + ") FROM " + table)->GetValue(0, 0);
+            auto since = watermark.IsNull() ? "" : ", since := TIMESTAMP " + KeywordHelper::WriteQuoted(watermark.ToString());
+            run_query(con, "CREATE OR REPLACE TEMPORARY TABLE " + std::string(CHANGES_TABLE) + " AS SELECT * FROM " + scan +
+                               since + ")");
+
+            auto counts = run_query(con, "SELECT count(*), count(*) FILTER (WHERE " + page_id + " IN (SELECT " + page_id +
+                                             " FROM " + table + ")) FROM " + CHANGES_TABLE);
+            auto changed = counts->GetValue(0, 0).GetValue<int64_t>();
+            auto updated = counts->GetValue(1, 0).GetValue<int64_t>();
+
+            run_query(con, "DELETE FROM " + table + " WHERE " + page_id + " IN (SELECT " + page_id + " FROM " +
+                               CHANGES_TABLE + ")");
+            run_query(con, "INSERT INTO " + table + " BY NAME SELECT * FROM " + CHANGES_TABLE);
+
+            // Archived and trashed pages are left out of query results, so they can only be found by what is
+            // missing. This reads every page of the database, so it only runs when asked for with detect_deletes.
+            // Only the page id is projected, which keeps the scan to the smallest payload Notion returns.
+            int64_t deleted = 0;
+            if (bind_data.detect_deletes && !watermark.IsNull())
+            {
+                auto result = run_query(con, "DELETE FROM " + table + " WHERE " + page_id + " NOT IN (SELECT " + page_id +
+                                                 " FROM " + scan + "))");
+                deleted = result->GetValue(0, 0).GetValue<int64_t>();
+            }
+
+            auto new_watermark = run_query(con, "SELECT max(" + last_edited_time + ") FROM " + table)->GetValue(0, 0);
+            run_query(con, "DROP TABLE " + std::string(CHANGES_TABLE));
+            con.Commit();
+
+            output.SetValue(0, 0, Value::BIGINT(changed - updated));
+            output.SetValue(1, 0, Value::BIGINT(updated));
+            output.SetValue(2, 0, Value::BIGINT(deleted));
+            output.SetValue(3, 0, new_watermark);
+            output.SetCardinality(1);
+        }
+        catch (...)
+        {
+            if (con.HasActiveTransaction())
+            {
+                con.Rollback();
+            }
+            throw;
+        }
+    }
+
+    TableFunction notion_sync_table_function()
+    {
+        TableFunction function("notion_sync", {LogicalType::VARCHAR, LogicalType::VARCHAR}, notion_sync_function,
+                               notion_sync_bind, notion_sync_init_global);
+        function.named_parameters["detect_deletes"] = LogicalType::BOOLEAN;
+        return function;
+    }
+
+} // namespace duckdb
@@ -1,10 +1,12 @@
 #include "notion_utils.hpp"
 #include "notion_requests.hpp"
 #include "duckdb/common/exception.hpp"
+#include "duckdb/common/string_util.hpp"
+#include <algorithm>
 #include <regex>
 #include <json.hpp>
-#include <iostream>
 #include <sstream>
+#include <unordered_map>
 
 using json = nlohmann::json;
 namespace duckdb
@@ -24,8 +26,18 @@ namespace duckdb
             return input;
         }
 
-        // Extract ID from Notion URL
-        std::regex notion_url_pattern("notion\\.so/(?:[^/]+/)?([a-fA-F0-9]{32})(?:\\?.*)?$");
+        // The API returns ids as UUIDs, e.g. 1499ce5d-31c9-8024-9613-ee3558225560
+        std::regex uuid_pattern("^[a-fA-F0-9]{8}-[a-fA-F0-9]{4}-[a-fA-F0-9]{4}-[a-fA-F0-9]{4}-[a-fA-F0-9]{12}$");
+        if (std::regex_match(input, uuid_pattern))
+        {
+            std::string id = input;
+            id.erase(std::remove(id.begin(), id.end(), '-'), id.end());
+            return id;
+        }
+
+        // Extract ID from Notion URL, e.g. https://www.notion.so/workspace/Tasks-1499ce5d31c980249613ee3558225560?v=...
+        // Shared pages are served from <workspace>.notion.site
+        std::regex notion_url_pattern("notion\\.(?:so|site)/(?:[^/?#]+/)?(?:[^/?#]*-)?([a-fA-F0-9]{32})(?:[?#].*)?$");
         std::smatch match;
         if (std::regex_search(input, match, notion_url_pattern) && match.size() > 1)
         {
@@ -58,33 +70,110 @@ namespace duckdb
         throw duckdb::InvalidInputException("Invalid Google Sheets URL or ID");
     }
 
+    NotionPropertyType parse_notion_property_type(const std::string &type)
+    {
+        static const std::unordered_map<std::string, NotionPropertyType> property_types = {
+            {"checkbox", NotionPropertyType::CHECKBOX},
+            {"created_by", NotionPropertyType::CREATED_BY},
+            {"created_time", NotionPropertyType::CREATED_TIME},
+            {"date", NotionPropertyType::DATE},
+            {"email", NotionPropertyType::EMAIL},
+            {"files", NotionPropertyType::FILES},
+            {"formula", NotionPropertyType::FORMULA},
+            {"last_edited_by", NotionPropertyType::LAST_EDITED_BY},
+            {"last_edited_time", NotionPropertyType::LAST_EDITED_TIME},
+            {"multi_select", NotionPropertyType::MULTI_SELECT},
+            {"number", NotionPropertyType::NUMBER},
+            {"people", NotionPropertyType::PEOPLE},
+            {"phone_number", NotionPropertyType::PHONE_NUMBER},
+            {"relation", NotionPropertyType::RELATION},
+            {"rich_text", NotionPropertyType::RICH_TEXT},
+            {"rollup", NotionPropertyType::ROLLUP},
+            {"select", NotionPropertyType::SELECT},
+            {"status", NotionPropertyType::STATUS},
+            {"title", NotionPropertyType::TITLE},
+            {"url", NotionPropertyType::URL},
+        };
+
+        auto entry = property_types.find(type);
+        if (entry == property_types.end())
+        {
+            return NotionPropertyType::UNKNOWN;
+        }
+        return entry->second;
+    }
+
+    const json *find_notion_property(const json &properties, const std::string &name)
+    {
+        auto entry = properties.find(name);
+        if (entry != properties.end())
+        {
+            return &*entry;
+        }
+        for (auto &property : properties.items())
+        {
+            if (StringUtil::CIEquals(property.key(), name))
+            {
+                return &property.value();
+            }
+        }
+        return nullptr;
+    }
+
+    std::string notion_timestamp_to_iso8601(timestamp_t timestamp)
+    {
+        auto result = Timestamp::ToString(timestamp);
+        auto separator = result.find(' ');
+        if (separator != std::string::npos)
+        {
+            result[separator] = 'T';
+        }
+        return result + "Z";
+    }
+
+    std::string clean_json_control_characters(const std::string &json_str)
+    {
+        std::string clean_str;
+        clean_str.reserve(json_str.size());
+
+        for (char c : json_str) {
+            // Skip control characters except \n, \r, \t
+            if (iscntrl(static_cast<unsigned char>(c))) {
+                if (c == '\n') clean_str += "\\n";
+                else if (c == '\r') clean_str += "\\r";
+                else if (c == '\t') clean_str += "\\t";
+                continue;
+            }
+            clean_str += c;
+        }
+        return clean_str;
+    }
+
+    //! The number of characters of an unparseable response quoted in the error
+    static constexpr idx_t NOTION_JSON_ERROR_EXCERPT_SIZE = 200;
+
     json parse_json(const std::string &json_str)
     {
         try
         {
-            // Clean control characters from the string
-            std::string clean_str;
-            clean_str.reserve(json_str.size());
-            
-            for (char c : json_str) {
-                // Skip control characters except \n, \r, \t
-                if (iscntrl(static_cast<unsigned char>(c))) {
-                    if (c == '\n') clean_str += "\\n";
-                    else if (c == '\r') clean_str += "\\r";
-                    else if (c == '\t') clean_str += "\\t";
-                    continue;
-                }
-                clean_str += c;
+            // Only copy the string when it has control characters to strip
+            bool has_control_characters = std::any_of(json_str.begin(), json_str.end(), [](char c)
+                                                      { return iscntrl(static_cast<unsigned char>(c)); });
+            if (has_control_characters)
+            {
+                return json::parse(clean_json_control_characters(json_str));
             }
-
-            // Parse the cleaned JSON
-            return json::parse(clean_str);
+            return json::parse(json_str);
         }
         catch (const json::exception &e)
         {
-            std::cerr << "JSON parsing error: " << e.what() << std::endl;
-            std::cerr << "Raw JSON string: " << json_str << std::endl;
-            throw;
+            // Only the start of the response, it may be large and hold page contents
+            auto excerpt = json_str.substr(0, NOTION_JSON_ERROR_EXCERPT_SIZE);
+            if (json_str.size() > excerpt.size())
+            {
+                excerpt += "...";
+            }
+            throw IOException("Invalid JSON in Notion API response: %s, response starts with: %s", e.what(), excerpt);
         }
     }
 